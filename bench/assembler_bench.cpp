@@ -0,0 +1,280 @@
+// times every stage of the assembler on generated sources of growing size,
+// in ns per source line (find_symbol: per lookup) and bytes allocated
+// usage: ./assembler_bench [options]
+//        ./assembler_bench --generate lines [options] > file.s
+// options: --max lines      largest input, sizes go 1K, 10K, ... up to it (default 1M)
+//          -j threads       threads for both passes (default 1)
+//          --alu N --branch N --mem N --word N --skip N
+//                           relative weights of the statement kinds
+//          --labels N       percent of lines that get a label
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <atomic>
+#include <filesystem>
+#include <new>
+#include <cstdlib>
+
+#include "../inc/parser.h"
+#include "../inc/assembler.h"
+#include "../inc/symbol_table.h"
+
+// every allocation of the process is counted, a stage reports the difference
+static std::atomic<size_t> allocated_bytes(0);
+
+void* operator new(size_t size)
+{
+    allocated_bytes += size;
+    void* p = std::malloc(size ? size : 1);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+// how the generated source is made up
+struct Mix
+{
+    int alu = 40;
+    int branch = 15;
+    int mem = 25;
+    int word = 10;
+    int skip = 10;
+    int labels = 10; // percent of lines
+};
+
+// a valid program: every symbol is an extern or a label defined earlier,
+// a new section starts every 10000 lines and the sections are reopened in turn
+static void generate(std::ostream& out, size_t lines, const Mix& mix, uint seed)
+{
+    std::mt19937 random(seed);
+    auto pick = [&](int n) { return (int)(random() % n); };
+
+    static const char* ALU[] = {"add", "sub", "mul", "div", "cmp", "and", "or", "xor", "test", "shl", "shr", "xchg"};
+    static const char* BRANCH[] = {"jmp", "jeq", "jne", "jgt", "call"};
+
+    int total = mix.alu + mix.branch + mix.mem + mix.word + mix.skip;
+    size_t labels = 0;
+
+    // a defined label or an extern
+    auto symbol = [&]() -> std::string
+    {
+        if(labels == 0 || pick(8) == 0)
+            return "ext" + std::to_string(pick(4));
+        return "l" + std::to_string(pick(labels));
+    };
+
+    out << ".extern ext0, ext1, ext2, ext3\n";
+    for(size_t i = 0; i < lines; i++)
+    {
+        if(i % 10000 == 0)
+            out << ".section s" << (i / 10000) % 8 << "\n";
+
+        if(pick(100) < mix.labels)
+            out << "l" << labels++ << ": ";
+
+        int kind = pick(total);
+        if((kind -= mix.alu) < 0)
+            out << ALU[pick(12)] << " r" << pick(6) << ", r" << pick(6); // r6 and r7 are sp and pc
+        else if((kind -= mix.branch) < 0)
+        {
+            out << BRANCH[pick(5)] << " ";
+            switch(pick(4))
+            {
+            case 0: out << symbol(); break;
+            case 1: out << "%" << symbol(); break;
+            case 2: out << "*[r" << pick(8) << " + 0x" << std::hex << pick(256) << std::dec << "]"; break;
+            default: out << "*r" << pick(8); break;
+            }
+        }
+        else if((kind -= mix.mem) < 0)
+        {
+            // only a load takes an immediate
+            bool load = pick(2);
+            out << (load ? "ldr" : "str") << " r" << pick(8) << ", ";
+            switch(load ? pick(6) : 2 + pick(4))
+            {
+            case 0: out << "$" << symbol(); break;
+            case 1: out << "$0x" << std::hex << pick(65536) << std::dec; break;
+            case 2: out << symbol(); break;
+            case 3: out << "%" << symbol(); break;
+            case 4: out << "[r" << pick(8) << " + " << pick(100) << "]"; break;
+            default: out << "[r" << pick(8) << "]"; break;
+            }
+        }
+        else if((kind -= mix.word) < 0)
+        {
+            if(pick(2))
+                out << ".word " << symbol();
+            else
+                out << ".word " << pick(65536);
+        }
+        else
+            out << ".skip " << 1 + pick(16);
+        out << "\n";
+    }
+    out << ".end\n";
+}
+
+struct Timing
+{
+    double ns;
+    size_t bytes;
+};
+
+template<typename F>
+static Timing measure(F stage)
+{
+    size_t bytes = allocated_bytes;
+    auto start = std::chrono::steady_clock::now();
+    stage();
+    auto end = std::chrono::steady_clock::now();
+    return Timing{std::chrono::duration<double, std::nano>(end - start).count(), allocated_bytes - bytes};
+}
+
+static void report(const char* stage, size_t lines, Timing timing, size_t count)
+{
+    std::cout << std::setw(10) << lines << "  " << std::left << std::setw(14) << stage << std::right
+              << std::setw(12) << timing.ns / count << " ns"
+              << std::setw(12) << timing.bytes / 1048576.0 << " MB" << std::endl;
+}
+
+static void usage(const std::string& message)
+{
+    std::cout << "ERROR " << message << ", usage: assembler_bench [--max lines] [-j threads] [--alu N] [--branch N] [--mem N] [--word N] [--skip N] [--labels N]" << std::endl;
+    std::cout << "                             assembler_bench --generate lines [options] > file.s" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    Mix mix;
+    size_t max_lines = 1000000;
+    size_t generate_lines = 0;
+    uint threads = 1;
+
+    // every option takes a value
+    for(int i = 1; i < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        static const char* OPTIONS[] = {"--max", "--generate", "-j", "--alu", "--branch", "--mem", "--word", "--skip", "--labels"};
+        if(std::find(std::begin(OPTIONS), std::end(OPTIONS), arg) == std::end(OPTIONS))
+        {
+            usage("unknown option " + arg);
+            return 1;
+        }
+        if(i + 1 == argc)
+        {
+            usage("no value after " + arg);
+            return 1;
+        }
+
+        long value = std::atol(argv[i + 1]);
+        if(arg == "--max") max_lines = value;
+        else if(arg == "--generate") generate_lines = value;
+        else if(arg == "-j") threads = value;
+        else if(arg == "--alu") mix.alu = value;
+        else if(arg == "--branch") mix.branch = value;
+        else if(arg == "--mem") mix.mem = value;
+        else if(arg == "--word") mix.word = value;
+        else if(arg == "--skip") mix.skip = value;
+        else if(arg == "--labels") mix.labels = value;
+    }
+
+    if(mix.alu + mix.branch + mix.mem + mix.word + mix.skip <= 0)
+    {
+        std::cout << "ERROR the statement weights add up to 0" << std::endl;
+        return 1;
+    }
+
+    if(generate_lines != 0)
+    {
+        generate(std::cout, generate_lines, mix, 1);
+        return 0;
+    }
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::string source = (dir / "assembler_bench.s").string();
+    std::string object = (dir / "assembler_bench.o").string();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "     lines  stage                   time     allocated" << std::endl;
+
+    for(size_t lines = 1000; lines <= max_lines; lines *= 10)
+    {
+        {
+            std::ofstream out(source);
+            generate(out, lines, mix, 1);
+        }
+
+        try
+        {
+            // tokenizing on its own, the passes do it again
+            Parser parser(source);
+            std::vector<std::string_view> input;
+            parser.parse_file(input);
+            std::vector<std::string_view> tokens;
+            size_t token_count = 0;
+            report("tokenize", lines, measure([&]
+            {
+                for(std::string_view line : input)
+                {
+                    tokens.clear();
+                    parser.tokenize(line, tokens);
+                    token_count += tokens.size();
+                }
+            }), input.size());
+
+            Assembler as(&parser, object);
+            as.set_threads(threads);
+            report("first_pass", lines, measure([&] { as.first_pass(); }), input.size());
+            report("second_pass", lines, measure([&] { as.encode_sections(); }), input.size());
+            report("print_data", lines, measure([&] { as.print_data(); }), input.size());
+
+            // symbol lookups, one hit and one miss for every label
+            StringPool names;
+            SymbolTable symbols(names);
+            std::vector<std::string> labels, missing;
+            for(size_t i = 0; i < lines / 10; i++)
+            {
+                labels.push_back("l" + std::to_string(i));
+                missing.push_back("m" + std::to_string(i));
+                symbols.insert(labels.back(), 2, i, 'l');
+            }
+            int found = 0;
+            Timing lookup = measure([&]
+            {
+                for(size_t i = 0; i < labels.size(); i++)
+                {
+                    found += symbols.find(labels[i]) != -1;
+                    found += symbols.find(missing[i]) != -1;
+                }
+            });
+            if(found != (int)labels.size())
+            {
+                std::cout << "ERROR symbol lookups found " << found << " of " << labels.size() << std::endl;
+                return 1;
+            }
+            report("find_symbol", lines, lookup, 2 * labels.size());
+        }
+        catch(const AssemblerError& e)
+        {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::filesystem::remove(source);
+    std::filesystem::remove(object);
+    return 0;
+}
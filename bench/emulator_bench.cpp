@@ -0,0 +1,318 @@
+// runs programs on the interpreter and on the translated code, both must end in the same state:
+// registers, psw, memory, what was printed and the number of instructions
+// the programs are the ones in tests/, a few loops and random programs full of
+// jumps through registers, stores over code and interrupts
+// usage: ./emulator_bench [--random programs] [--seed N], run from the repository
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+#include <random>
+
+#include "../inc/libassembler.h"
+#include "../inc/linker.h"
+#include "../inc/emulator.h"
+#include "../inc/jit.h"
+
+struct Program
+{
+    std::string name;
+    std::vector<std::string> sources;
+    uint64_t max_instructions; // 0 for up to halt
+};
+
+struct Result
+{
+    std::string state;
+    std::vector<uint8_t> memory;
+    std::string output;
+    uint64_t executed;
+    double seconds;
+};
+
+// every source assembled in memory and linked with the ivt at 0
+static std::vector<uint8_t> build(const Program& program)
+{
+    MemoryAssembler assembler;
+    std::vector<ObjectFile> objects;
+    std::vector<std::string> names;
+    for(size_t i = 0; i < program.sources.size(); i++)
+    {
+        objects.push_back(assembler.assemble(program.sources[i]));
+        names.push_back(program.name + "#" + std::to_string(i));
+        if(!objects.back().ok)
+            throw AssemblerError() << objects.back().diagnostics.at(0);
+    }
+
+    ThreadPool pool(1);
+    Linker linker(pool);
+    linker.place("ivt", 0);
+    linker.link(objects, names);
+    return linker.image();
+}
+
+static Result run(const std::vector<uint8_t>& image, uint64_t max_instructions, bool translate)
+{
+    Emulator emulator;
+    emulator.load_image(image);
+
+    // what the program prints is kept to be compared
+    std::ostringstream output;
+    std::streambuf* console = std::cout.rdbuf(output.rdbuf());
+    auto start = std::chrono::steady_clock::now();
+    emulator.run(max_instructions, false, translate);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout.rdbuf(console);
+
+    std::ostringstream state;
+    emulator.print_state(state);
+    state << (emulator.halted() ? "halted" : "running");
+    return Result{state.str(), emulator.image(), output.str(), emulator.executed(), seconds};
+}
+
+static std::string read_file(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if(!file)
+        throw AssemblerError() << "ERROR opening input file: " << filename;
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+static const char* ALU_LOOP =
+    ".section ivt\n.word start\n.skip 14\n"
+    ".section code\n"
+    "start: ldr r0, $0\nldr r1, $1\nldr r2, $0\nldr r3, $1000\n"
+    "outer: ldr r4, $0\n"
+    "inner: add r4, r1\nadd r0, r4\nxor r0, r3\nshl r0, r1\nmul r0, r3\ncmp r4, r3\njne inner\n"
+    "ldr r4, $0x7FFF\nand r4, r0\nstr r4, value\nadd r2, r1\nldr r5, $20000\ncmp r2, r5\njne %outer\n"
+    "halt\n"
+    "value: .word 0\n.end\n";
+
+// sum(n) = n + sum(n - 1), through the stack
+static const char* CALL_LOOP =
+    ".section ivt\n.word start\n.skip 14\n"
+    ".section code\n"
+    "start: ldr r2, $0\nldr r3, $0\n"
+    "again: ldr r0, $100\ncall sum\nadd r2, r0\nldr r1, $1\nadd r3, r1\nldr r1, $20000\ncmp r3, r1\njne again\n"
+    "halt\n"
+    "sum: push r1\nldr r1, $0\ncmp r0, r1\njeq sum_end\npush r0\nldr r1, $1\nsub r0, r1\ncall sum\npop r1\nadd r0, r1\n"
+    "sum_end: pop r1\nret\n.end\n";
+
+// fills an array and adds it up again
+static const char* MEMORY_LOOP =
+    ".section ivt\n.word start\n.skip 14\n"
+    ".section code\n"
+    "start: ldr r5, $0\nldr r3, $3\nldr r4, $512\n"
+    "again: ldr r0, $0\nldr r1, $0\n"
+    "fill: str r1, [r0 + array]\nadd r1, r3\nldr r2, $2\nadd r0, r2\ncmp r0, r4\njne fill\n"
+    "ldr r0, $0\nldr r1, $0\n"
+    "sum: ldr r2, [r0 + array]\nadd r1, r2\nldr r2, $2\nadd r0, r2\ncmp r0, r4\njne sum\n"
+    "str r1, total\nldr r2, $1\nadd r5, r2\nldr r2, $5000\ncmp r5, r2\njne again\n"
+    "halt\n"
+    "total: .word 0\narray: .skip 512\n.end\n";
+
+// the immediate of an ldr is rewritten by the loop it is in
+static const char* SELF_MODIFYING_LOOP =
+    ".section ivt\n.word start\n.skip 14\n"
+    ".section code\n"
+    "start: ldr r2, $patched\nldr r1, $3\nadd r2, r1\nldr r1, $1\nldr r3, $0\nldr r4, $2000\n"
+    "patched: ldr r0, $0\nadd r0, r1\nstr r0, [r2]\nadd r3, r1\ncmp r3, r4\njne patched\n"
+    "halt\n.end\n";
+
+// any instruction with any operands; the vectors and the targets are labels of the program,
+// but r6 and r7 are written too, so it also runs from the middle of instructions and over data
+static std::string random_program(uint seed, int lines)
+{
+    std::mt19937 random(seed);
+    auto pick = [&](int n) { return (int)(random() % n); };
+    // alu, stack and int instructions take r0-r5, ldr, str and branches any register
+    auto low = [&]() { return "r" + std::to_string(pick(6)); };
+    auto reg = [&]() { return "r" + std::to_string(pick(10) < 8 ? pick(6) : 6 + pick(2)); };
+    auto label = [&]() { return "l" + std::to_string(pick(lines)); };
+    auto literal = [&]()
+    {
+        std::ostringstream text;
+        if(pick(2))
+            text << pick(0x10000);
+        else
+            text << "0x" << std::hex << pick(0x100);
+        return text.str();
+    };
+
+    std::ostringstream out;
+    out << ".section ivt\n";
+    for(int i = 0; i < 8; i++)
+        out << ".word " << label() << "\n";
+    out << ".section code\n";
+
+    static const char* ALU[] = {"xchg", "add", "sub", "mul", "div", "cmp", "and", "or", "xor", "test", "shl", "shr"};
+    static const char* BRANCH[] = {"jmp", "jeq", "jne", "jgt", "call"};
+    for(int i = 0; i < lines; i++)
+    {
+        out << "l" << i << ": ";
+        int kind = pick(100);
+        if(kind < 2)
+            out << (pick(4) == 0 ? "halt" : "iret");
+        else if(kind < 4)
+            out << "int " << low();
+        else if(kind < 6)
+            out << "ret";
+        else if(kind < 20)
+        {
+            out << BRANCH[pick(5)] << " ";
+            switch(pick(8))
+            {
+            case 0: out << "*" << reg(); break;
+            case 1: out << "*[" << reg() << "]"; break;
+            case 2: out << "*[" << reg() << " + " << literal() << "]"; break;
+            case 3: out << "*" << label(); break;
+            case 4: out << "%" << label(); break;
+            default: out << label(); break;
+            }
+        }
+        else if(kind < 50)
+            out << ALU[pick(12)] << " " << low() << ", " << low();
+        else if(kind < 53)
+            out << "not " << low();
+        else if(kind < 60)
+            out << (pick(2) ? "push " : "pop ") << low();
+        else
+        {
+            bool load = pick(3) != 0;
+            out << (load ? "ldr " : "str ") << reg() << ", ";
+            switch(pick(load ? 9 : 7))
+            {
+            case 0: out << reg(); break;
+            case 1: out << "[" << reg() << "]"; break;
+            case 2: out << "[" << reg() << " + " << literal() << "]"; break;
+            case 3: out << "[" << reg() << " + " << label() << "]"; break;
+            case 4: out << label(); break;
+            case 5: out << "%" << label(); break;
+            case 6: out << literal(); break;
+            case 7: out << "$" << literal(); break;
+            default: out << "$" << label(); break;
+            }
+        }
+        out << "\n";
+    }
+    out << ".end\n";
+    return out.str();
+}
+
+// both runs of a program, the first difference is reported
+static bool compare(const Program& program, Result& interpreted, Result& translated)
+{
+    std::vector<uint8_t> image = build(program);
+    interpreted = run(image, program.max_instructions, false);
+    translated = run(image, program.max_instructions, true);
+
+    std::string difference;
+    if(interpreted.state != translated.state)
+        difference = "the state\n" + interpreted.state + "\nvs\n" + translated.state;
+    else if(interpreted.executed != translated.executed)
+        difference = "the number of instructions " + std::to_string(interpreted.executed) + " vs " + std::to_string(translated.executed);
+    else if(interpreted.output != translated.output)
+        difference = "the output";
+    else if(interpreted.memory != translated.memory)
+    {
+        size_t i = 0;
+        while(interpreted.memory[i] == translated.memory[i])
+            i++;
+        difference = "the memory at " + std::to_string(i);
+    }
+
+    if(!difference.empty())
+        std::cout << "ERROR " << program.name << ", the interpreter and the translated code differ in " << difference << std::endl;
+    return difference.empty();
+}
+
+int main(int argc, char* argv[])
+{
+    int programs = 1000;
+    uint seed = 1;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--random" && i + 1 < argc)
+            programs = atoi(argv[++i]);
+        else if(arg == "--seed" && i + 1 < argc)
+            seed = atoi(argv[++i]);
+        else
+        {
+            std::cout << "ERROR unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if(!Jit::available())
+    {
+        std::cout << "ERROR the translator needs an x86-64 host" << std::endl;
+        return 1;
+    }
+
+    std::vector<Program> timed;
+    try
+    {
+        // without the devices the tests wait for interrupts that never come, they stop after max instructions
+        timed.push_back(Program{"tests/test_main.s", {read_file("tests/test_interrupts.s"), read_file("tests/test_main.s")}, 10000000});
+        // a and b are the externs of both tests, fja their only entry point
+        timed.push_back(Program{"tests/test_one.s", {read_file("tests/test_one.s"), read_file("tests/test_two.s"),
+            ".global a, b\n.extern fja\n.section ivt\n.word fja, fja, fja, fja, fja, fja, fja, fja\n.section stub\na: .word 0x40\nb: .word 0\n.end\n"},
+            10000000});
+    }
+    catch(const AssemblerError& e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    timed.push_back(Program{"alu loop", {ALU_LOOP}, 0});
+    timed.push_back(Program{"call loop", {CALL_LOOP}, 0});
+    timed.push_back(Program{"memory loop", {MEMORY_LOOP}, 0});
+    timed.push_back(Program{"self modifying loop", {SELF_MODIFYING_LOOP}, 0});
+
+    std::cout << std::fixed;
+    for(const Program& program : timed)
+    {
+        Result interpreted, translated;
+        if(!compare(program, interpreted, translated))
+            return 1;
+        if(interpreted.executed < 1000000)
+        {
+            std::cout << program.name << ": " << interpreted.executed << " instructions, the same on both" << std::endl;
+            continue;
+        }
+        std::cout << std::setprecision(1) << program.name << ": " << interpreted.executed << " instructions, interpreter "
+                  << interpreted.executed / interpreted.seconds / 1e6 << " M/s, translated " << translated.executed / translated.seconds / 1e6
+                  << " M/s, speedup " << interpreted.seconds / translated.seconds << "x" << std::endl;
+    }
+
+    uint64_t instructions = 0;
+    for(int i = 0; i < programs; i++)
+    {
+        Program program{"random program " + std::to_string(seed + i), {random_program(seed + i, 200)}, 200000};
+        Result interpreted, translated;
+        try
+        {
+            if(!compare(program, interpreted, translated))
+            {
+                std::cout << program.sources.at(0);
+                return 1;
+            }
+        }
+        catch(const AssemblerError& e)
+        {
+            std::cout << "ERROR " << program.name << ": " << e.what() << std::endl;
+            return 1;
+        }
+        instructions += interpreted.executed;
+    }
+    std::cout << programs << " random programs, " << instructions << " instructions, the same on both" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+// compares printing section contents byte by byte through iostream, as print_object_file used to, with hex_dump
+// usage: ./hex_bench [megabytes]
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+#include <random>
+
+#include "../inc/hex.h"
+
+// the loop print_object_file had before hex_dump
+static std::string iostream_dump(const std::vector<uint8_t>& data)
+{
+    std::ostringstream out;
+    out << std::hex << std::uppercase << std::setfill('0');
+    for(size_t i = 0; i < data.size(); i++)
+    {
+        out << std::setw(2) << (int)data[i];
+        out << ((i % 16 == 15 || i + 1 == data.size()) ? '\n' : ' ');
+    }
+    return out.str();
+}
+
+static std::string table_dump(const std::vector<uint8_t>& data)
+{
+    std::string text(hex_dump_size(data.size()), '\0');
+    hex_dump(data.data(), data.size(), 0, &text[0]);
+    text.back() = '\n';
+    return text;
+}
+
+template<typename F>
+static double ms_per_dump(const std::vector<uint8_t>& data, int iterations, F dump, std::string& result)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++)
+        result = dump(data);
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 16;
+
+    // an odd size, so the last line is a short one
+    std::vector<uint8_t> data(megabytes * 1024 * 1024 + 7);
+    std::mt19937 random(1);
+    for(uint8_t& byte : data)
+        byte = random();
+
+    // both must print the same text before the timings mean anything
+    std::string iostream_text, table_text;
+    double iostream_ms = ms_per_dump(data, 3, iostream_dump, iostream_text);
+    double table_ms = ms_per_dump(data, 10, table_dump, table_text);
+    if(iostream_text != table_text)
+    {
+        std::cout << "ERROR output mismatch" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << megabytes << " MB section: iostream " << iostream_ms << " ms, hex table " << table_ms
+              << " ms, speedup " << iostream_ms / table_ms << "x" << std::endl;
+
+    return 0;
+}
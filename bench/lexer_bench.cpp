@@ -0,0 +1,127 @@
+// compares the std::regex cascade the assembler used to classify operands with the hand-written lexer
+// usage: ./lexer_bench [iterations]
+
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+
+#include "../inc/lexer.h"
+
+// the regexes that were used by Assembler::branch_handler_sp and Assembler::mem_handler_sp
+static const std::regex BRANCH_LITERAL_REGEX("^(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
+static const std::regex BRANCH_SYMBOL_REGEX("^[a-zA-Z]\\w*$");
+static const std::regex BRANCH_PCREL_REGEX("^%[a-zA-Z]\\w*$");
+static const std::regex BRANCH_MEMLITERAL_REGEX("^\\*(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
+static const std::regex BRANCH_MEMSYMBOL_REGEX("^\\*[a-zA-Z]\\w*$");
+static const std::regex BRANCH_REGDIR_REGEX("^\\*r[0-7]$");
+static const std::regex BRANCH_REGIND_REGEX("^\\*\\[r[0-7]\\]$");
+static const std::regex BRANCH_LITERALREGIND_REGEX("^\\*\\[r[0-7]\\s?\\+\\s?(([0-9]+)|(0[xX][0-9A-Fa-f]+))\\]$");
+static const std::regex BRANCH_SYMBOLREGIND_REGEX("^\\*\\[r[0-7]\\s?\\+\\s?[a-zA-Z]\\w*\\]$");
+
+static const std::regex LS_LITERAL_REGEX("^\\$(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
+static const std::regex LS_SYMBOL_REGEX("^\\$[a-zA-Z]\\w*$");
+static const std::regex LS_MEMLITERAL_REGEX("^(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
+static const std::regex LS_MEMSYMBOL_REGEX("^[a-zA-Z]\\w*$");
+static const std::regex LS_PCRELSYMBOL_REGEX("^%[a-zA-Z]\\w*$");
+static const std::regex LS_REGDIR_REGEX("^r[0-7]$");
+static const std::regex LS_REGIND_REGEX("^\\[r[0-7]\\]$");
+static const std::regex LS_LITERALREGIND_REGEX("^\\[r[0-7]\\s?\\+\\s?(([0-9]+)|(0[xX][0-9A-Fa-f]+))\\]$");
+static const std::regex LS_SYMBOLREGIND_REGEX("^\\[r[0-7]\\s?\\+\\s?[a-zA-Z]\\w*\\]$");
+
+// same order of checks as the old second pass, returns the index of the matching regex
+static int regex_branch(const std::string& token)
+{
+    const std::regex* cascade[] = {
+        &BRANCH_LITERAL_REGEX, &BRANCH_SYMBOL_REGEX, &BRANCH_PCREL_REGEX, &BRANCH_MEMLITERAL_REGEX,
+        &BRANCH_REGDIR_REGEX, &BRANCH_MEMSYMBOL_REGEX, &BRANCH_REGIND_REGEX,
+        &BRANCH_LITERALREGIND_REGEX, &BRANCH_SYMBOLREGIND_REGEX
+    };
+    for(int i = 0; i < 9; i++)
+        if(std::regex_match(token, *cascade[i]))
+            return i;
+    return -1;
+}
+
+static int regex_data(const std::string& token)
+{
+    const std::regex* cascade[] = {
+        &LS_LITERAL_REGEX, &LS_SYMBOL_REGEX, &LS_MEMLITERAL_REGEX, &LS_REGDIR_REGEX, &LS_MEMSYMBOL_REGEX,
+        &LS_PCRELSYMBOL_REGEX, &LS_REGIND_REGEX, &LS_LITERALREGIND_REGEX, &LS_SYMBOLREGIND_REGEX
+    };
+    for(int i = 0; i < 9; i++)
+        if(std::regex_match(token, *cascade[i]))
+            return i;
+    return -1;
+}
+
+template<typename F>
+static double ns_per_operand(const std::vector<std::string>& tokens, int iterations, F classify)
+{
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++)
+        for(const std::string& token : tokens)
+            checksum += classify(token);
+    auto end = std::chrono::steady_clock::now();
+
+    // keep the compiler from dropping the loop
+    if(checksum == 42)
+        std::cout << "";
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / ((double)iterations * tokens.size());
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 20000;
+
+    std::vector<std::string> branch_tokens = {
+        "0x1234", "lab_a", "%isr_reset", "*0x65", "*myCounter", "*r3", "*[r5]", "*[r1+0x12]", "*[r5+lab_a]"
+    };
+    std::vector<std::string> data_tokens = {
+        "$0x1", "$asciiCode", "0x65", "term_out", "%myCounter", "r2", "[r2]", "[r0+0x7]", "[r2+c]"
+    };
+
+    // both paths must agree on every operand before the timings mean anything
+    for(const std::string& token : branch_tokens)
+    {
+        bool regex_ok = regex_branch(token) >= 0;
+        bool lexer_ok = Lexer::branch_operand(token).mode != OperandMode::INVALID;
+        if(regex_ok != lexer_ok)
+        {
+            std::cout << "ERROR classification mismatch for " << token << std::endl;
+            return 1;
+        }
+    }
+    for(const std::string& token : data_tokens)
+    {
+        bool regex_ok = regex_data(token) >= 0;
+        bool lexer_ok = Lexer::data_operand(token).mode != OperandMode::INVALID;
+        if(regex_ok != lexer_ok)
+        {
+            std::cout << "ERROR classification mismatch for " << token << std::endl;
+            return 1;
+        }
+    }
+
+    double regex_branch_ns = ns_per_operand(branch_tokens, iterations / 10, regex_branch);
+    double lexer_branch_ns = ns_per_operand(branch_tokens, iterations, [](const std::string& t) {
+        return (int)Lexer::branch_operand(t).mode;
+    });
+    double regex_data_ns = ns_per_operand(data_tokens, iterations / 10, regex_data);
+    double lexer_data_ns = ns_per_operand(data_tokens, iterations, [](const std::string& t) {
+        return (int)Lexer::data_operand(t).mode;
+    });
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "branch operands: regex " << regex_branch_ns << " ns, lexer " << lexer_branch_ns
+              << " ns, speedup " << regex_branch_ns / lexer_branch_ns << "x" << std::endl;
+    std::cout << "ldr/str operands: regex " << regex_data_ns << " ns, lexer " << lexer_data_ns
+              << " ns, speedup " << regex_data_ns / lexer_data_ns << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// bump allocator, memory is handed out from big blocks and only
+// given back all at once when the arena is destroyed
+class Arena
+{
+public:
+    Arena();
+
+    void* allocate(size_t size, size_t align);
+    std::string_view copy(std::string_view text); // the copy lives as long as the arena
+
+    // free everything that was handed out, the first block is kept for reuse
+    void clear();
+
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]> > blocks;
+    size_t first_block_size;
+    char* next; // free space of the last block
+    size_t left;
+};
+
+// growable array of plain values stored in an arena, one table column
+// elements are kept in fixed size pieces, so they never move
+template<typename T>
+class Column
+{
+    static_assert(std::is_trivially_copyable<T>::value, "columns hold plain values");
+
+public:
+    Column(Arena& _arena) : arena(_arena), count(0)
+    {}
+
+    // the values belong to the arena of the table
+    Column(const Column&) = delete;
+    Column& operator=(const Column&) = delete;
+
+    void push_back(const T& value)
+    {
+        if(count == pieces.size() * PIECE)
+            pieces.push_back((T*)arena.allocate(PIECE * sizeof(T), alignof(T)));
+        pieces[count / PIECE][count % PIECE] = value;
+        count++;
+    }
+
+    // drop the last elements, their memory is reused by the next push_back
+    void shrink(size_t size) { count = size; }
+    // drop everything, has to be called before the arena is cleared
+    void clear() { pieces.clear(); count = 0; }
+
+    T& operator[](size_t i) { return pieces[i / PIECE][i % PIECE]; }
+    const T& operator[](size_t i) const { return pieces[i / PIECE][i % PIECE]; }
+    size_t size() const { return count; }
+
+private:
+    static const size_t PIECE = 1024;
+
+    Arena& arena;
+    std::vector<T*> pieces;
+    size_t count;
+};
+
+#endif
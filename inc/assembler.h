@@ -3,194 +3,136 @@
 
 #include <iostream>
 #include <iomanip>
-#include <regex>
 #include <fstream>
-
-#include "parser.h"
-
-typedef unsigned int uint;
-
-struct Symbol
-{
-    std::string label;
-    std::string section;
-    long offset;
-    char scope;
-    int index;
-
-    Symbol(std::string _label, std::string _section, long _offset, char _scope, int _index) :
-        label(_label), section(_section), offset(_offset), scope(_scope), index(_index)
-    {}
-};
-
-struct RelRecord
-{
-    int offset;
-    std::string type;
-    int symbol_number;
-    std::string section;
-
-    RelRecord(int _offset, std::string _type, int _symbol_number, std::string _section) :
-    offset(_offset), type(_type), symbol_number(_symbol_number), section(_section)
-    {}
-};
-
-class Assembler
+#include <deque>
+#include <charconv>
+#include <chrono>
+
+#include "pass.h"
+#include "scanner.h"
+#include "encoder.h"
+#include "symbol_table.h"
+#include "thread_pool.h"
+#include "hex.h"
+#include "object_file.h"
+#include "include_cache.h"
+#include "peephole.h"
+
+class Assembler : public Pass
 {
 public:
     Assembler(Parser* _parser, std::string _output_file);
+    Assembler(); // no input and no output file, load gives it an input
     ~Assembler();
 
+    // start over on another input, the tables keep their memory
+    void load(Parser* _parser);
+
     void first_pass();
-    void second_pass();
+    void second_pass(); // encode_sections, then print_data
+
+    // optional, between the passes: remove instructions that do nothing, see peephole.h
+    void optimize();
+
+    // the two steps of the second pass
+    void encode_sections();
+    void print_data(); // print everything into the output file
+
+    // checks and encodes every line once, forward references are patched
+    // when their symbol is defined; the output is the same as with two passes
+    void one_pass(); // scan_and_encode, then print_data
+    void scan_and_encode();
+
+    // the assembled object as values, instead of print_data
+    void export_object(ObjectFile& object);
+
+    // threads used by both passes, 0 uses one per core
+    void set_threads(uint _threads);
+    // run on a pool shared with other assemblers instead of an own one
+    void set_thread_pool(ThreadPool* pool);
+
+    // times and totals of the phases that have run
+    const Stats& stats() const { return statistics; }
+
+    // files read by .include, each once, in the order they were first included
+    const std::vector<std::shared_ptr<const IncludeFile> >& includes() const { return included; }
+
+    // the same error with its line number counted in the file the line came from,
+    // the passes count lines after the includes are put in
+    AssemblerError located(const AssemblerError& error) const;
 
 
 private:
-    // first pass
-    void label_handler();
-    void directive_handler();
-    void instruction_handler();
-
-    // directive handlers first pass
-    void extern_handler_fp();
-    void section_handler_fp();
-    void word_handler_fp();
-    void skip_handler_fp();
-    void equ_handler_fp();
-    void end_handler_fp();
-    void global_handler_fp();
-
-
-    // second pass
-    void directive_handler_sp();
-    void instruction_handler_sp();
-
-    //directive handlers second pass
-    void section_handler_sp();
-    void word_handler_sp();
-    void global_handler_sp();
-    void skip_handler_sp();
-    void end_handler_sp();
-
-    // these are called by the instruction handler
-    void twobyte_handler_sp(std::string opcode);
-    void branch_handler_sp(); // handling jmp, jeq, jgt, jne and call
-    void mem_handler_sp(); // used to handle ldr and str
-    void stack_handler_sp(); // used to handle push and pop
+    void read_input(); // lines of the parser's input
+
+    // replace every .include line with the lines of its file, recursively
+    void expand_includes();
+    void include_lines(const std::vector<std::string_view>& source, const std::string& file, std::vector<std::string>& stack);
+
+    // first pass, split into chunks that can be scanned at the same time
+    void scan_parallel();
+    void define_symbols(const Scanner& scanner); // add what a scanner found, in source order
+    void section_switch(const std::string& name, uint end_of_run);
+    void open_blank_section(); // code before the first .section, once it has a byte or a .skip
 
     // helper functions
-    Symbol* find_symbol(std::string label); // find simbol by name
-    std::string write_hex(int val, int num_of_nibbles); // returns hex representation of a num, ex. 17 => 00 11
-    std::string extract_register_num(std::string token); // get register number, ex. r3 => 3
-    std::string extract_between_chars(std::string str, char from, char to); // returns a substring between chars
-    std::string form_expression(); // concat register indirect addressing to one string with no spaces
-    int literal_to_number(std::string literal); // convert a literal (hex or decimal) to an integer
-
-    // when compilation is done, print everything into the output file
-    void print_data();
+    int define_symbol(std::string_view label, int section, int32_t offset, char scope); // error if it exists
+
+    void apply_globals(); // mark .global symbols, error if one was never defined
+
+    // second pass, split into chunks that can be encoded at the same time
+    void encode_parallel();
+
+    ThreadPool& workers(); // started the first time it is needed
+
+    // parts of the output file
     void print_symtab(std::ofstream& outfile);
     void print_reloc(std::ofstream& outfile);
     void print_object_file(std::ofstream& outfile);
+    void print_section(std::ofstream& outfile, const Section& section); // contents with the zero runs
 
 
     // member variables
-    Parser* parser;
+    uint location_counter; // where the current section run starts
 
-    std::string current_section;
+    std::vector<std::string_view> lines; // lines of the input file, owned by the parser or an IncludeFile
 
-    uint line_counter; // current line
-    uint location_counter;
-    uint token_counter; // current token in line
+    // where a run of lines came from, empty if nothing was included
+    struct LineOrigin
+    {
+        size_t first; // index in lines
+        std::string file;
+        uint line; // of lines[first] in file
+    };
+    std::vector<LineOrigin> origins;
+    std::vector<std::shared_ptr<const IncludeFile> > included;
 
-    std::vector<std::string> lines; // lines read from a file
-    std::vector<std::string> line_tokens; // current line tokens
+    std::vector<Section> sections; // object file output, in order of appearance
 
-    std::vector<std::string> output; // object file output
+    StringPool names; // labels and section names, shared by all the tables
+    SymbolTable symbol_table;
+    RelocationTable relocation_table;
 
-    std::vector<Symbol*> symbol_table;
-    std::vector<RelRecord *> relocation_table;
+    Peephole peephole;
 
-    bool end_reached; // stop the compilation
+    std::vector<std::pair<std::string, uint> > pending_globals; // .global symbols and their lines
 
-    std::string output_file; // simple text file
+    // recorded by the first pass for the second one
+    std::vector<std::pair<size_t, int> > section_starts; // line index of each .section and its name id
+    size_t encoded_lines; // lines up to and including .end
+
+    Encoder* encoder; // one pass, encodes every line right after it is checked
 
-    // constants used
-
-    // for external symbols
-    const std::string UNDEFINED_SECTION = "UND";
-    // for equ
-    const std::string ABSOLUTE_SECTION = "ABS";
-    // for relocations
-    const std::string RELOCATION_ABSOLUTE = "R_HYPO_16";
-    const std::string RELOCATION_PCREL = "R_HYPO_PC16";
-
-    // directive mneumonics
-    const std::string GLOBAL_DIRECTIVE = ".global";
-    const std::string EXTERN_DIRECTIVE = ".extern";
-    const std::string SECTION_DIRECTIVE = ".section";
-    const std::string WORD_DIRECTIVE = ".word";
-    const std::string SKIP_DIRECTIVE = ".skip";
-    const std::string EQU_DIRECTIVE = ".equ";
-    const std::string END_DIRECTIVE = ".end";
-
-    // instruction mneumonics
-    const std::string HALT_MNE = "halt";
-    const std::string IRET_MNE = "iret";
-    const std::string RET_MNE = "ret";
-    const std::string XCHG_MNE = "xchg"; 
-    const std::string ADD_MNE = "add";
-    const std::string SUB_MNE = "sub";
-    const std::string MUL_MNE = "mul";
-    const std::string DIV_MNE = "div";
-    const std::string CMP_MNE = "cmp";
-    const std::string AND_MNE = "and"; 
-    const std::string OR_MNE = "or";
-    const std::string XOR_MNE = "xor";
-    const std::string TEST_MNE = "test";
-    const std::string SHL_MNE = "shl";
-    const std::string SHR_MNE = "shr";
-    const std::string NOT_MNE = "not";
-    const std::string INT_MNE = "int";
-    const std::string JMP_MNE = "jmp";
-    const std::string JEQ_MNE = "jeq";
-    const std::string JNE_MNE = "jne";
-    const std::string JGT_MNE = "jgt";
-    const std::string CALL_MNE = "call";
-    const std::string LDR_MNE = "ldr";
-    const std::string STR_MNE = "str";
-    const std::string PUSH_MNE = "push";
-    const std::string POP_MNE = "pop";
-
-
-    // regexes used
-    static const std::regex WORD_LITERAL_REGEX;
-    static const std::regex WORD_SYMBOL_REGEX;
-
-    static const std::regex REGISTER_INSTRUCTION_REGEX;
-
-    // branch and call addressing modes and formats
-    static const std::regex BRANCH_LITERAL_REGEX;
-    static const std::regex BRANCH_SYMBOL_REGEX;
-    static const std::regex BRANCH_PCREL_REGEX;
-    static const std::regex BRANCH_MEMLITERAL_REGEX;
-    static const std::regex BRANCH_MEMSYMBOL_REGEX;
-    static const std::regex BRANCH_REGDIR_REGEX;
-    static const std::regex BRANCH_REGIND_REGEX; 
-    static const std::regex BRANCH_LITERALREGIND_REGEX; 
-    static const std::regex BRANCH_SYMBOLREGIND_REGEX;
-
-    // load store addressing modes and formats
-    static const std::regex LS_LITERAL_REGEX;
-    static const std::regex LS_SYMBOL_REGEX;
-    static const std::regex LS_MEMLITERAL_REGEX;
-    static const std::regex LS_MEMSYMBOL_REGEX;
-    static const std::regex LS_PCRELSYMBOL_REGEX;
-    static const std::regex LS_REGDIR_REGEX;
-    static const std::regex LS_REGIND_REGEX;   
-    static const std::regex LS_LITERALREGIND_REGEX;   
-    static const std::regex LS_SYMBOLREGIND_REGEX;  
+    uint threads;
+    ThreadPool* thread_pool;
+    bool own_thread_pool;
 
+    std::string output_file; // simple text file
+    Stats statistics;
 
+    // lines handled by one task of the parallel passes
+    static const size_t CHUNK_LINES = 16384;
+    static const size_t ZERO_PIECE = 4096; // zero bytes printed at a time
 };
 
 
@@ -0,0 +1,111 @@
+#ifndef _DISASSEMBLER_H_
+#define _DISASSEMBLER_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+
+#include "isa.h"
+#include "object_file.h"
+#include "error.h"
+#include "stats.h"
+
+// writes an object file the assembler printed back as assembly source; assembling
+// that source gives the same sections with the same bytes, symbols and relocations
+// (a section that was reopened comes back in one piece, its symbols are numbered in
+// another order then)
+// the symbol table and the relocations are kept in memory, the sections are read and
+// written as they stream by, only the bytes since the last label are held, up to
+// SPAN_LIMIT of them
+class Disassembler
+{
+public:
+    Disassembler(const std::string& _input, const std::string& _output);
+
+    void disassemble();
+
+    Stats stats() const { return statistics; }
+
+private:
+    // one instruction the way the encoder writes it
+    struct Decoded
+    {
+        const Instruction* instruction;
+        uint8_t size; // 0 if the bytes are not an instruction
+        uint8_t reg_d;
+        uint8_t reg_s;
+        uint8_t mode;
+        uint16_t word; // the operand of 5 byte instructions
+    };
+
+    static Decoded decode(const uint8_t* bytes, size_t available);
+
+    // reading
+    bool next_line(std::string_view& line);
+    void read_tables(); // the symbol table and the relocations, up to the object file header
+    void read_sections();
+    AssemblerError invalid_line(std::string_view line) const;
+
+    // one section, a span is the bytes from one label to the next
+    void start_section(const std::string& name, uint32_t size);
+    void add_bytes(std::string_view line);
+    void finish_span(bool at_label);
+    void finish_section();
+
+    // the pieces a span is cut into: instructions, .word and zero bytes
+    bool fits(const Decoded& d, size_t at) const; // the relocations in it are its operand
+    bool fits_word(size_t at) const;
+
+    // writing
+    void print_symbols_before(int number); // .extern and .equ lines, so symbols keep their numbers
+    void print_labels(uint32_t offset);
+    void print(const Decoded& d, size_t at);
+    void print_operand(const Decoded& d, size_t at);
+    void print_word(uint16_t word); // a literal
+    void print_zeros(uint64_t count);
+    void flush(bool force = false);
+
+    std::string input;
+    std::string output;
+    std::ifstream in;
+    std::ofstream out;
+
+    // the input read a block at a time
+    std::vector<char> block;
+    size_t block_start;
+    size_t block_end;
+    bool end_of_file;
+    size_t line_number;
+
+    std::vector<ObjectSymbol> symbols;
+    std::unordered_map<std::string, std::vector<ObjectRelocation>> relocations; // by section, sorted by offset
+    std::unordered_map<uint16_t, int> equ_values; // value to symbol, for pc relative operands
+    std::vector<int> unplaced; // extern and equ symbols by number
+    size_t next_unplaced;
+
+    std::string section;
+    bool sections_written;
+    uint32_t section_size;
+    uint32_t section_offset; // bytes read so far
+    std::vector<std::pair<uint32_t, int>> labels; // offset and symbol, sorted
+    size_t next_label;
+    const std::vector<ObjectRelocation>* section_relocations;
+    size_t next_relocation; // the first one at or after span_start
+
+    std::vector<uint8_t> span;
+    uint32_t span_start; // section offset of span[0]
+    std::vector<int> span_relocations; // for every byte of the span, the index into section_relocations or -1
+    enum Piece : uint8_t {NO_PIECE, ZERO, INSTRUCTION, WORD, END};
+    uint64_t zeros_before; // a zero run at the end of the part of the span that was written
+    std::vector<Piece> pieces; // for every byte of the span, the piece to start there so the rest still fits
+
+    std::string text; // written out once it is large
+    Stats statistics;
+
+    static const size_t BLOCK_SIZE = 1 << 20;
+    static const size_t SPAN_LIMIT = 1 << 20; // longer spans are written a part at a time
+    static const size_t SPAN_KEPT = 8; // bytes kept back when a part is written, more than an instruction
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _DRIVER_H_
+#define _DRIVER_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "thread_pool.h"
+
+// what one run of the assembler does, from its command line or from a client of --serve
+struct Options
+{
+    std::vector<std::string> inputs;
+    std::string output;
+    std::string cache_dir;
+    bool one_pass = false;
+    bool peephole = false; // remove instructions that do nothing between the passes
+    bool stats = false;
+    bool stats_json = false;
+    bool dependencies = false; // -MD, write output.d for make
+    bool disassemble = false; // -d, the inputs are object files written back as source
+    int threads = 0;
+
+    std::string serve; // socket to listen on
+    std::string server; // socket of a server to send the run to
+    bool stop = false; // ask the server to exit
+
+    std::string directory; // relative paths are relative to it, empty for the current directory
+    std::string source; // input "-" sent by a client
+    bool has_source = false;
+};
+
+// false if the arguments are wrong, the reason is written to out
+// response files are read here, relative to options.directory
+bool parse_options(const std::vector<std::string>& args, Options& options, std::ostream& out);
+
+// assemble the inputs of options, errors are written to out and --stats to err
+// the files use pool if it is given, otherwise one is made for the run
+// returns the exit status
+int run(const Options& options, ThreadPool* pool, std::ostream& out, std::ostream& err);
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _EMULATOR_H_
+#define _EMULATOR_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include "error.h"
+
+class Jit;
+
+// runs images written by the linker: r0-r5, r6 the stack pointer, r7 the pc and psw,
+// 64KB of memory with 16 bit big endian words like the assembler writes them
+// and memory mapped registers from 0xFF00 up:
+//     0xFF00 term_out, the low byte of a word written here is printed
+//     0xFF02 term_in, the last character read from the standard input
+//     0xFF10 tim_cfg, period of the timer, 0-7: 500ms, 1s, 1.5s, 2s, 5s, 10s, 30s, 60s
+// the interrupt vector table is at 0 and holds 8 words: 0 reset (the first pc),
+// 1 invalid instruction, 2 timer, 3 terminal, the rest for int
+// every instruction is decoded the first time it runs and kept decoded,
+// a store over code drops what was decoded from it
+// with translate the blocks of the program run as x86-64 code, see jit.h
+class Emulator
+{
+    friend class Jit;
+
+public:
+    Emulator();
+
+    // the "addr: bytes" lines of the linker, throws if they are broken
+    void load_hex(const std::string& filename);
+    // the whole memory at once, like Linker::image()
+    void load_image(const std::vector<uint8_t>& image);
+
+    // run from the reset vector until halt or until max_instructions have run (0 for no limit),
+    // devices: the terminal and the timer run and raise their interrupts
+    // translate: blocks of instructions are translated to x86-64 code, throws if that is not possible
+    void run(uint64_t max_instructions = 0, bool devices = true, bool translate = false);
+
+    uint64_t executed() const { return instruction_count; }
+    bool halted() const { return halt_reached; }
+    uint16_t reg(int i) const { return regs[i]; }
+    uint16_t status() const { return psw; }
+    const std::vector<uint8_t>& image() const { return memory; }
+
+    // psw and the registers, the way the emulator prints them when it stops
+    void print_state(std::ostream& out) const;
+
+    // psw bits
+    static const uint16_t PSW_Z = 1 << 0;
+    static const uint16_t PSW_O = 1 << 1;
+    static const uint16_t PSW_C = 1 << 2;
+    static const uint16_t PSW_N = 1 << 3;
+    static const uint16_t PSW_TR = 1 << 13; // timer masked
+    static const uint16_t PSW_TL = 1 << 14; // terminal masked
+    static const uint16_t PSW_I = 1 << 15; // all external interrupts masked
+
+    static const uint32_t MEMORY_SIZE = 0x10000;
+    static const uint16_t TERM_OUT = 0xFF00;
+    static const uint16_t TERM_IN = 0xFF02;
+    static const uint16_t TIM_CFG = 0xFF10;
+    static const uint16_t STACK_START = 0xFF00; // sp before the first push, below the registers
+
+    enum Vector {RESET = 0, ERROR = 1, TIMER = 2, TERMINAL = 3};
+
+private:
+    // one instruction, decoded; the kinds of ldr and str are split by
+    // addressing mode, so the hot ones don't look at the mode again
+    enum Op : uint8_t
+    {
+        UNDECODED, INVALID,
+        HALT, INT, IRET, CALL, RET, JMP, JEQ, JNE, JGT,
+        XCHG, ADD, SUB, MUL, DIV, CMP, NOT, AND, OR, XOR, TEST, SHL, SHR,
+        LDR_IMM, LDR_REG, LDR_IND, LDR_DISP, LDR_MEM,
+        STR_REG, STR_IND, STR_DISP, STR_MEM,
+        PUSH, POP,
+        OP_COUNT
+    };
+
+    struct Decoded
+    {
+        Op op;
+        uint8_t size;
+        uint8_t reg_d;
+        uint8_t reg_s;
+        uint8_t mode; // addressing mode of a branch
+        uint16_t payload;
+    };
+
+    Decoded decode(uint16_t address) const;
+
+    uint16_t read_word(uint16_t address) const { return memory[address] << 8 | memory[(uint16_t)(address + 1)]; }
+    void write_word(uint16_t address, uint16_t value);
+    void push(uint16_t value);
+    uint16_t pop();
+
+    uint16_t branch_target(const Decoded& d) const;
+    void interrupt(int vector); // push pc and psw, mask interrupts, jump through the table
+
+    // the terminal and the timer, looked at every POLL_INSTRUCTIONS instructions
+    void poll_devices();
+    void start_terminal();
+    void stop_terminal();
+
+    std::vector<uint8_t> memory;
+    std::vector<Decoded> decoded; // by address
+    uint16_t regs[8];
+    uint16_t psw;
+
+    uint64_t instruction_count;
+    bool halt_reached;
+    Jit* jit; // while a translated run is going
+
+    bool terminal_started;
+    bool input_open; // the standard input has not ended
+    bool terminal_pending; // a character waits for its interrupt
+    std::chrono::steady_clock::time_point next_tick;
+
+    static const uint32_t POLL_INSTRUCTIONS = 4096;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _ENCODER_H_
+#define _ENCODER_H_
+
+#include <unordered_map>
+
+#include "pass.h"
+#include "symbol_table.h"
+
+// use of a symbol that was not defined yet, one pass only
+struct Fixup
+{
+    int section;
+    uint offset; // index in the section data of the word to patch
+    int relocation; // reserved entry in the relocation bucket of the section
+    uint line;
+    int next; // previous use of the same symbol, -1 ends the chain
+
+    Fixup(int _section, uint _offset, int _relocation, uint _line, int _next) :
+    section(_section), offset(_offset), relocation(_relocation), line(_line), next(_next)
+    {}
+};
+
+// the second pass: turns lines into machine code and relocation records
+// the symbol table is only read, so encoders working on different parts
+// of the source can run at the same time, each with its own output
+class Encoder : public Pass
+{
+public:
+    Encoder(Parser* _parser, const SymbolTable& _symbol_table, std::vector<Section>& _sections, RelocationTable& _relocation_table);
+
+    // encode lines [first, last), the first one is in the given section (string pool id)
+    void encode(const std::vector<std::string_view>& lines, size_t first, size_t last, int section);
+
+    // encode a line another pass has tokenized, starting at the given token
+    void encode_line(const std::vector<std::string_view>& tokens, uint first_token, uint line);
+
+    // one pass: symbols used before they are defined are patched later
+    void allow_forward_references();
+    void resolve_fixups(int symbol); // patch all uses of a symbol that was just defined
+    void finish_fixups(); // error for symbols that were never defined
+
+private:
+    void directive_handler_sp();
+    void instruction_handler_sp();
+
+    //directive handlers second pass
+    void section_handler_sp();
+    void word_handler_sp();
+    void skip_handler_sp();
+
+    // these are called by the instruction handler
+    void twobyte_handler_sp(uint8_t opcode);
+    void branch_handler_sp(uint8_t opcode); // handling jmp, jeq, jgt, jne and call
+    void mem_handler_sp(uint8_t opcode); // used to handle ldr and str
+    void stack_handler_sp(uint8_t opcode); // used to handle push and pop
+
+    Section& current_data(); // section the code is written into
+
+    // write machine code into the current section
+    void emit_byte(uint8_t byte);
+    void emit_word(uint16_t word); // high byte first, ex. 0x1234 => 12 34
+    void emit_symbol(std::string_view label, RelocationType relocation_type); // symbol value, adds a relocation if needed
+
+    void add_fixup(std::string_view label, RelocationType relocation_type);
+
+
+    const SymbolTable& symbol_table;
+
+    // output
+    std::vector<Section>& sections;
+    RelocationTable& relocation_table;
+
+    bool forward_references;
+    std::vector<Fixup> fixups;
+    std::unordered_map<std::string, int> fixup_heads; // last fixup of each undefined symbol
+};
+
+#endif
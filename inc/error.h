@@ -0,0 +1,29 @@
+#ifndef _ERROR_H_
+#define _ERROR_H_
+
+#include <exception>
+#include <sstream>
+#include <string>
+
+// thrown instead of exiting, so one bad input stops only its own assembly
+// the message is written like to std::cout:
+// throw AssemblerError() << "ERROR in line " << line_counter << ", ...";
+class AssemblerError : public std::exception
+{
+public:
+    template<typename T>
+    AssemblerError& operator<<(const T& value)
+    {
+        std::ostringstream text;
+        text << value;
+        message += text.str();
+        return *this;
+    }
+
+    const char* what() const noexcept override { return message.c_str(); }
+
+private:
+    std::string message;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _HEX_H_
+#define _HEX_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// section contents as the object file prints them: two uppercase hex digits
+// per byte, 16 bytes a line separated by spaces
+// column is the place of the first byte in its line, a byte in the last column
+// is followed by '\n', a shorter last line has to be ended by the caller
+
+// every byte takes its two digits and the separator after it
+inline size_t hex_dump_size(size_t size) { return size * 3; }
+
+// both write hex_dump_size(size) characters to out
+void hex_dump(const uint8_t* data, size_t size, size_t column, char* out);
+void hex_zeros(size_t size, size_t column, char* out); // a run of zero bytes
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _INCLUDE_CACHE_H_
+#define _INCLUDE_CACHE_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <ctime>
+#include <sys/types.h>
+
+#include "parser.h"
+
+// an included file split into lines, shared by every input that includes it
+struct IncludeFile
+{
+    std::string path;
+    std::string text;
+    std::vector<std::string_view> lines; // point into text
+
+    IncludeFile(const std::string& _path) : path(_path), parser(_path) {}
+
+    Parser parser; // splits text, the same way as the inputs
+};
+
+// files read by .include, once per process: an entry is used again as long
+// as the file keeps its modification time and size; safe to use from the
+// threads of batch mode and of the server
+class IncludeCache
+{
+public:
+    // the one every assembler uses
+    static IncludeCache& shared();
+
+    // throws if the file can't be read; the file keeps the path it was first read by
+    std::shared_ptr<const IncludeFile> get(const std::string& path);
+
+    // absolute, with no . or .. and no symbolic links, the path itself if that fails
+    static std::string normalize(const std::string& path);
+
+private:
+    struct Entry
+    {
+        struct timespec modified;
+        off_t size;
+        std::shared_ptr<const IncludeFile> file;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries; // by normalized path
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef _ISA_H_
+#define _ISA_H_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// instructions and directives of the language, both passes look them up here
+
+// operands an instruction takes, decides how it is checked and encoded
+enum class Format
+{
+    NONE,     // halt, iret, ret
+    REG_PAIR, // regD, regS
+    REG,      // not regD
+    INT,      // int regD
+    BRANCH,   // one jump operand
+    DATA,     // regD, data operand
+    STACK     // push / pop regD, a store / load through r6
+};
+
+struct Instruction
+{
+    std::string_view mnemonic;
+    uint8_t opcode;
+    Format format;
+    uint8_t size; // bytes, branch and data operands without a 16 bit word are 2 shorter
+};
+
+constexpr std::array<Instruction, 26> INSTRUCTIONS = {{
+    {"halt", 0x00, Format::NONE, 1},
+    {"iret", 0x20, Format::NONE, 1},
+    {"ret",  0x40, Format::NONE, 1},
+    {"int",  0x10, Format::INT, 2},
+    {"xchg", 0x60, Format::REG_PAIR, 2},
+    {"add",  0x70, Format::REG_PAIR, 2},
+    {"sub",  0x71, Format::REG_PAIR, 2},
+    {"mul",  0x72, Format::REG_PAIR, 2},
+    {"div",  0x73, Format::REG_PAIR, 2},
+    {"cmp",  0x74, Format::REG_PAIR, 2},
+    {"not",  0x80, Format::REG, 2},
+    {"and",  0x81, Format::REG_PAIR, 2},
+    {"or",   0x82, Format::REG_PAIR, 2},
+    {"xor",  0x83, Format::REG_PAIR, 2},
+    {"test", 0x84, Format::REG_PAIR, 2},
+    {"shl",  0x90, Format::REG_PAIR, 2},
+    {"shr",  0x91, Format::REG_PAIR, 2},
+    {"jmp",  0x50, Format::BRANCH, 5},
+    {"jeq",  0x51, Format::BRANCH, 5},
+    {"jne",  0x52, Format::BRANCH, 5},
+    {"jgt",  0x53, Format::BRANCH, 5},
+    {"call", 0x30, Format::BRANCH, 5},
+    {"ldr",  0xA0, Format::DATA, 5},
+    {"str",  0xB0, Format::DATA, 5},
+    {"push", 0xB0, Format::STACK, 3},
+    {"pop",  0xA0, Format::STACK, 3}
+}};
+
+// opcodes the encoder treats specially
+constexpr uint8_t LOAD_OPCODE = 0xA0;
+constexpr uint8_t STORE_OPCODE = 0xB0;
+
+enum class DirectiveKind {GLOBAL, EXTERN, SECTION, WORD, SKIP, EQU, END};
+
+struct Directive
+{
+    std::string_view mnemonic;
+    DirectiveKind kind;
+};
+
+constexpr std::array<Directive, 7> DIRECTIVES = {{
+    {".global", DirectiveKind::GLOBAL},
+    {".extern", DirectiveKind::EXTERN},
+    {".section", DirectiveKind::SECTION},
+    {".word", DirectiveKind::WORD},
+    {".skip", DirectiveKind::SKIP},
+    {".equ", DirectiveKind::EQU},
+    {".end", DirectiveKind::END}
+}};
+
+
+// perfect hash, found at compile time: every mnemonic of a table gets its
+// own slot, so a lookup is one hash and one string compare
+constexpr uint32_t mnemonic_hash(std::string_view text, uint32_t seed)
+{
+    uint32_t hash = seed;
+    for(char c : text)
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    // the low bits of a product only see the low bits of the input
+    return hash ^ (hash >> 16);
+}
+
+template<size_t SLOTS>
+struct PerfectHash
+{
+    uint32_t seed; // 0 if none was found
+    std::array<int8_t, SLOTS> slots; // table index, -1 if empty
+
+    constexpr size_t slot(std::string_view text) const { return mnemonic_hash(text, seed) & (SLOTS - 1); }
+};
+
+template<size_t SLOTS, typename T, size_t N>
+constexpr PerfectHash<SLOTS> make_perfect_hash(const std::array<T, N>& table)
+{
+    static_assert((SLOTS & (SLOTS - 1)) == 0 && N < SLOTS, "slots must be a power of two larger than the table");
+
+    for(uint32_t seed = 2166136261u; seed < 2166136261u + 10000; seed++)
+    {
+        PerfectHash<SLOTS> hash{seed, {}};
+        for(int8_t& slot : hash.slots)
+            slot = -1;
+
+        bool collision = false;
+        for(size_t i = 0; i < N && !collision; i++)
+        {
+            int8_t& slot = hash.slots[hash.slot(table[i].mnemonic)];
+            collision = slot != -1;
+            slot = i;
+        }
+        if(!collision)
+            return hash;
+    }
+    return PerfectHash<SLOTS>{0, {}};
+}
+
+constexpr PerfectHash<64> INSTRUCTION_HASH = make_perfect_hash<64>(INSTRUCTIONS);
+constexpr PerfectHash<16> DIRECTIVE_HASH = make_perfect_hash<16>(DIRECTIVES);
+
+static_assert(INSTRUCTION_HASH.seed != 0, "no perfect hash for the instructions");
+static_assert(DIRECTIVE_HASH.seed != 0, "no perfect hash for the directives");
+
+// nullptr if there is no such instruction
+inline const Instruction* find_instruction(std::string_view mnemonic)
+{
+    int8_t index = INSTRUCTION_HASH.slots[INSTRUCTION_HASH.slot(mnemonic)];
+    if(index == -1 || INSTRUCTIONS[index].mnemonic != mnemonic)
+        return nullptr;
+    return &INSTRUCTIONS[index];
+}
+
+// nullptr if there is no such directive
+inline const Directive* find_directive(std::string_view mnemonic)
+{
+    int8_t index = DIRECTIVE_HASH.slots[DIRECTIVE_HASH.slot(mnemonic)];
+    if(index == -1 || DIRECTIVES[index].mnemonic != mnemonic)
+        return nullptr;
+    return &DIRECTIVES[index];
+}
+
+
+// the other way, every opcode byte to its instruction for the disassembler;
+// push and pop share their opcodes with str and ldr, those keep the slot
+// and the mode byte tells them apart
+constexpr std::array<int8_t, 256> make_opcode_table()
+{
+    std::array<int8_t, 256> table = {};
+    for(int8_t& slot : table)
+        slot = -1;
+    for(size_t i = 0; i < INSTRUCTIONS.size(); i++)
+    {
+        if(INSTRUCTIONS[i].format != Format::STACK)
+            table[INSTRUCTIONS[i].opcode] = i;
+    }
+    return table;
+}
+
+constexpr std::array<int8_t, 256> OPCODES = make_opcode_table();
+
+// nullptr if no instruction has this opcode
+inline const Instruction* find_opcode(uint8_t opcode)
+{
+    return OPCODES[opcode] == -1 ? nullptr : &INSTRUCTIONS[OPCODES[opcode]];
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef _JIT_H_
+#define _JIT_H_
+
+#include <vector>
+#include <cstdint>
+#include <initializer_list>
+
+#include "emulator.h"
+
+// translates the code of an Emulator into x86-64 code a basic block at a time
+// a block runs up to its branch or up to an instruction left to the interpreter
+// (halt, int, iret and invalid ones) and jumps straight into the next block once
+// that one is translated; r0-r6 are held in host registers while blocks run and
+// written back on the way out, the memory stays in the emulator, so translated
+// code and the interpreter take turns on the same state
+class Jit
+{
+public:
+    Jit(Emulator& _emulator);
+    ~Jit();
+
+    // translated code only runs on an x86-64 host
+    static bool available();
+
+    // runs blocks from the pc until budget instructions have run or the next
+    // instruction is left to the interpreter, returns the budget that is left
+    uint32_t run(uint32_t budget);
+
+    // the interpreter decoded these bytes, a store over them has to go through write_word
+    void mark(uint16_t address, uint8_t size)
+    {
+        for(uint8_t i = 0; i < size; i++)
+            code[(uint16_t)(address + i)] = 1;
+    }
+
+    // called by write_word, blocks are dropped when a store hits code
+    void written(uint16_t address)
+    {
+        if(code[address] | code[(uint16_t)(address + 1)])
+            flush();
+    }
+
+    void flush();
+
+private:
+    typedef Emulator::Decoded Decoded;
+
+    static bool translatable(const Decoded& d);
+    static bool branches(const Decoded& d);
+    static bool writes_pc(const Decoded& d);
+    static uint16_t sets_flags(const Decoded& d);
+    static bool may_leave(const Decoded& d);
+
+    uint8_t* translate(uint16_t pc);
+    void translate(const Decoded& d, uint16_t pc, uint16_t next, uint32_t refund, uint16_t live);
+    void target(const Decoded& d, uint16_t next, bool& constant, uint16_t& address);
+    void jump(bool constant, uint16_t address);
+
+    // pieces of translated code, eax holds addresses and ecx the words read and written
+    void get(uint8_t scratch, int reg, uint16_t next);
+    void set(int reg, uint8_t scratch);
+    void read();
+    void write(uint32_t refund, int next);
+    void flags(uint16_t mask);
+    void enter_block(uint16_t pc, uint32_t count);
+    void exit_to(uint16_t pc);
+    void exit_dynamic();
+    void exit_stop(uint16_t pc, uint32_t refund);
+
+    // x86-64 encoding
+    void put(std::initializer_list<uint8_t> bytes);
+    void put16(uint16_t value);
+    void put32(uint32_t value);
+    void put64(uint64_t value);
+    void operand(uint8_t reg, int32_t displacement); // [rbx + displacement]
+    void memory_operand(std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t displacement, bool word);
+    void registers(std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rm, bool word = false);
+    void zero_extend(uint8_t to, uint8_t from);
+    void move_immediate(uint8_t reg, uint32_t value);
+    void store_pc(uint8_t scratch);
+    void store_pc_immediate(uint16_t value);
+    uint8_t* branch(std::initializer_list<uint8_t> opcode); // returns the rel32 to bind
+    void bind(uint8_t* rel, const uint8_t* target);
+    void bind(uint8_t* rel) { bind(rel, at); }
+
+    // a store from translated code that has to go through the emulator, returns 1 if blocks were dropped
+    static int store_word(Jit* jit, uint32_t address, uint32_t value);
+
+    Emulator& emulator;
+
+    uint8_t* buffer; // mmap'd, readable, writable and executable
+    uint8_t* at; // where code is written
+    uint8_t* blocks_start; // after the entry and the exit
+    uint8_t* (*entry)(uint8_t* block);
+    uint8_t* exit;
+
+    std::vector<uint8_t*> blocks; // by address of the first instruction
+    std::vector<uint16_t> translated; // the addresses that have a block
+    std::vector<uint8_t> code; // 1 for bytes of decoded instructions
+    uint64_t budget_left;
+    uint64_t generation; // counts flushes
+    int32_t psw; // from the registers
+
+    static const size_t BUFFER_SIZE = 16 << 20;
+    static const size_t BLOCK_RESERVE = 32 << 10; // more than the largest block
+    static const uint32_t MAX_BLOCK = 32; // instructions
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef _LEXER_H_
+#define _LEXER_H_
+
+#include <string>
+#include <string_view>
+
+// addressing modes an operand can be written in
+// the comments show the branch syntax first and the ldr/str syntax second
+enum class OperandMode
+{
+    INVALID,
+    LITERAL,         // 0x12          $0x12
+    SYMBOL,          // sym           $sym
+    PCREL,           // %sym          %sym
+    MEM_LITERAL,     // *0x12         0x12
+    MEM_SYMBOL,      // *sym          sym
+    REG_DIR,         // *r3           r3
+    REG_IND,         // *[r3]         [r3]
+    REG_IND_LITERAL, // *[r3 + 0x12]  [r3 + 0x12]
+    REG_IND_SYMBOL   // *[r3 + sym]   [r3 + sym]
+};
+
+struct Operand
+{
+    OperandMode mode;
+    int reg; // register number, REG_* modes only
+    int literal; // value of the literal, *LITERAL modes only
+    std::string_view symbol; // points into the scanned token, *SYMBOL and PCREL modes only
+
+    Operand() : mode(OperandMode::INVALID), reg(-1), literal(0)
+    {}
+};
+
+// classifies operands and parses their literal/register/symbol in a single pass over the characters
+class Lexer
+{
+public:
+    // operand of jmp, jeq, jne, jgt and call
+    static Operand branch_operand(std::string_view token);
+    // second operand of ldr and str
+    static Operand data_operand(std::string_view token);
+
+    // decimal or hex (0x) number, the value is stored in *value if it is provided
+    static bool is_literal(std::string_view token, int* value = nullptr);
+    // letter followed by letters, digits or underscores
+    static bool is_symbol(std::string_view token);
+    // rX, where X is between 0 and max_reg
+    static bool is_register(std::string_view token, int max_reg, int* reg = nullptr);
+
+private:
+    // [rX], [rX + literal] and [rX + symbol], with at most one space around the '+'
+    static Operand scan_indirect(std::string_view token);
+    // literal or symbol, stored as the given mode
+    static Operand scan_value(std::string_view token, OperandMode literal_mode, OperandMode symbol_mode);
+
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+    static bool is_letter(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+    static int hex_digit(char c); // -1 if c is not a hex digit
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _LIBASSEMBLER_H_
+#define _LIBASSEMBLER_H_
+
+#include <string_view>
+
+#include "object_file.h"
+#include "parser.h"
+#include "assembler.h"
+
+// assembles sources held in memory, for programs linked with libassembler.a
+// nothing is read from or written to files and errors come back in the object;
+// one instance can be used for any number of sources, its tables keep their memory
+class MemoryAssembler
+{
+public:
+    MemoryAssembler(bool _one_pass = false, uint threads = 1);
+
+    // run the peephole stage between the passes, like --peephole; not with one pass
+    void set_peephole(bool _peephole) { peephole = _peephole; }
+
+    ObjectFile assemble(std::string_view source);
+    // the same, reusing the buffers object already has; returns object.ok
+    bool assemble(std::string_view source, ObjectFile& object);
+
+private:
+    bool one_pass;
+    bool peephole;
+    Parser parser;
+    Assembler assembler;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef _LINKER_H_
+#define _LINKER_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "object_file.h"
+#include "string_pool.h"
+#include "thread_pool.h"
+#include "error.h"
+
+// puts the sections of many objects into one 16 bit address space, resolves
+// their symbols and patches the relocations
+// sections with the same name are joined in the order of the objects, a
+// section without a place follows the ones before it, after the highest placed one
+class Linker
+{
+public:
+    // relocations are applied on pool, one task per object
+    Linker(ThreadPool& _pool);
+
+    // the section has to start at address
+    void place(const std::string& section, uint32_t address);
+
+    // filenames are only used in error messages
+    void link(const std::vector<ObjectFile>& objects, const std::vector<std::string>& filenames);
+
+    // the address space, bytes nothing was placed at are 0
+    const std::vector<uint8_t>& image() const { return memory; }
+
+    // the used part of the image, 8 bytes a line after their address: "0000: 00 01 ..."
+    void write_hex(std::ostream& out) const;
+
+    static const uint32_t ADDRESS_SPACE = 0x10000;
+
+private:
+    // one object's part of an output section
+    struct Piece
+    {
+        size_t object;
+        size_t section; // in the object
+        uint32_t offset; // in the output section
+    };
+
+    struct OutputSection
+    {
+        int name; // in section_names
+        uint32_t address;
+        uint32_t size;
+        std::vector<Piece> pieces;
+    };
+
+    void lay_out(const std::vector<ObjectFile>& objects);
+    void assign_addresses();
+    void define_globals(const std::vector<ObjectFile>& objects, const std::vector<std::string>& filenames);
+    // copy the sections of an object into the image and patch their relocations
+    void relocate(const ObjectFile& object, size_t index, const std::string& filename);
+
+    // address of a symbol of an object, throws if it is extern and nobody defines it
+    uint32_t symbol_address(const ObjectFile& object, size_t index, const ObjectSymbol& symbol, const std::string& filename) const;
+
+    ThreadPool& pool;
+
+    std::map<std::string, uint32_t> places; // -place options
+
+    StringPool section_names;
+    std::vector<OutputSection> sections; // index is the id in section_names
+    std::vector<std::vector<uint32_t> > section_addresses; // per object, of each of its sections
+
+    // the hash table of the globals: labels are interned, an id indexes the vectors
+    StringPool globals;
+    std::vector<uint32_t> global_addresses;
+    std::vector<size_t> global_objects; // that defined them
+
+    std::vector<uint8_t> memory;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef _OBJECT_H_
+#define _OBJECT_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "relocation_table.h"
+
+typedef unsigned int uint;
+
+// zero bytes that are not kept in the section data, .skip writes them
+struct Fill
+{
+    uint position; // index in data the run comes before
+    uint size;
+};
+
+struct Section
+{
+    int name; // id in the string pool
+    uint size; // counted by the first pass
+    uint skipped; // bytes of .skip, counted by the first pass
+    std::vector<uint8_t> data; // machine code, written by the second pass, without the fills
+    std::vector<Fill> fills; // in order of position
+    uint filled; // bytes in all fills
+
+    Section(int _name) : name(_name), size(0), skipped(0), filled(0)
+    {}
+
+    // offset of the next byte written
+    uint length() const { return data.size() + filled; }
+
+    // zero bytes at the end, next to the last run they make one
+    void fill(uint count)
+    {
+        if(count == 0)
+            return;
+        if(!fills.empty() && fills.back().position == data.size())
+            fills.back().size += count;
+        else
+            fills.push_back(Fill{(uint)data.size(), count});
+        filled += count;
+    }
+
+    // the contents with the zero runs written out
+    void flatten(std::vector<uint8_t>& out) const
+    {
+        out.clear();
+        out.reserve(length());
+        uint position = 0;
+        for(const Fill& run : fills)
+        {
+            out.insert(out.end(), data.begin() + position, data.begin() + run.position);
+            out.insert(out.end(), run.size, 0);
+            position = run.position;
+        }
+        out.insert(out.end(), data.begin() + position, data.end());
+    }
+
+    // the contents of another section at the end, returns the offset they start at
+    uint append(const Section& part)
+    {
+        uint base = length();
+        uint position = data.size();
+        for(const Fill& run : part.fills)
+        {
+            data.insert(data.end(), part.data.begin() + (data.size() - position), part.data.begin() + run.position);
+            fill(run.size);
+        }
+        data.insert(data.end(), part.data.begin() + (data.size() - position), part.data.end());
+        return base;
+    }
+};
+
+// index of the section with that name, added at the end if it doesn't exist
+inline int find_section(std::vector<Section>& sections, int name)
+{
+    for(int i = 0; i < sections.size(); i++)
+    {
+        if(sections.at(i).name == name)
+            return i;
+    }
+    sections.push_back(Section(name));
+    return sections.size() - 1;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _OBJECT_CACHE_H_
+#define _OBJECT_CACHE_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// part of every cache key, change it whenever the output for the same source changes
+#define ASSEMBLER_VERSION "two-pass-assembler 4"
+
+// objects stored under the hash of the source, the assembler version and the options
+// that change the output; any number of processes can share one directory,
+// an object is written to a temporary file and renamed into place
+// the cache never fails a build, a broken entry is a miss
+class ObjectCache
+{
+public:
+    ObjectCache(std::string _directory);
+
+    // includes: text of every file the source includes, in the order they are first included
+    std::string key(std::string_view source, const std::vector<std::string_view>& includes, const std::string& options) const;
+
+    // copy the cached object to output, false on a miss
+    bool fetch(const std::string& key, const std::string& output) const;
+    // put a freshly written object into the cache
+    void store(const std::string& key, const std::string& output) const;
+
+private:
+    std::string entry(const std::string& key) const; // directory/ab/abcd...o
+    std::string temporary(const std::string& near) const; // unique name in the same directory
+
+    std::string directory;
+};
+
+#endif
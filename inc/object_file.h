@@ -0,0 +1,45 @@
+#ifndef _OBJECT_FILE_H_
+#define _OBJECT_FILE_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "relocation_table.h"
+
+// what the output file holds, as values instead of text
+
+struct ObjectSection
+{
+    std::string name;
+    std::vector<uint8_t> data; // zero runs written out
+};
+
+// a symbol number is its index in ObjectFile::symbols
+struct ObjectSymbol
+{
+    std::string label;
+    std::string section; // UND for extern symbols, ABS for equ ones
+    int32_t offset;
+    char scope; // 'l' or 'g'
+};
+
+struct ObjectRelocation
+{
+    std::string section;
+    uint32_t offset; // of the 16 bit word to patch
+    RelocationType type;
+    int32_t symbol;
+};
+
+struct ObjectFile
+{
+    bool ok = false;
+    std::vector<std::string> diagnostics; // the error that stopped the assembly
+
+    std::vector<ObjectSection> sections;
+    std::vector<ObjectSymbol> symbols;
+    std::vector<ObjectRelocation> relocations; // grouped by section like in the output file
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _OBJECT_READER_H_
+#define _OBJECT_READER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "object_file.h"
+
+// the object file the assembler prints, read back into values;
+// throws if the file can't be read or is not one of its objects
+void read_object(const std::string& filename, ObjectFile& object);
+
+// the pieces of the format, shared with the disassembler that streams the sections instead
+
+// the parts of an object file, each one starts at a "# ---- NAME ----" line
+enum class ObjectBlock {NONE, SYMBOLS, RELOCATIONS, DATA};
+
+inline bool is_block_header(std::string_view line) { return line.size() > 2 && line.compare(0, 3, "# -") == 0; }
+inline bool is_section_header(std::string_view line) { return line.size() > 2 && line.compare(0, 3, "# .") == 0; }
+
+// the part a block header starts, NONE if it names none; section gets the name after REL.
+ObjectBlock block_header(std::string_view line, std::string& section);
+
+// "# .name size", false if it is not valid
+bool section_header(std::string_view line, std::string& name, uint32_t& size);
+
+// the columns of a line, the tables and the bytes have no commas and no comments
+void split_columns(std::string_view line, std::vector<std::string_view>& columns);
+
+// rows of the tables, false if they are not valid; number is the count of the symbols
+// before this one, the first row of the symbol table is its title, LABEL SECTION ...
+inline bool is_symbol_title(const std::vector<std::string_view>& columns) { return columns.front() == "LABEL"; }
+bool symbol_row(const std::vector<std::string_view>& columns, size_t number, ObjectSymbol& symbol);
+bool relocation_row(const std::vector<std::string_view>& columns, ObjectRelocation& relocation);
+
+#endif
@@ -3,27 +3,57 @@
 
 #include <iostream>
 #include <vector>
-#include <fstream>
-#include <sstream>
+#include <string>
+#include <string_view>
 #include <algorithm>
 
+#include "error.h"
+#include "stats.h"
+
 
 class Parser{
 public:
 
+    // "-" reads the standard input
     Parser(std::string _filename);
+    ~Parser();
+
+    // split the input into lines, the views point into the parser's copy of the file
+    // and stay valid for as long as the parser exists
+    void parse_file(std::vector<std::string_view>& output);
+
+    // parse_file splits this text instead of reading the file, it has to outlive the lines
+    void use_text(std::string_view text);
 
-    // read lines into output vector
-    void parse_file(std::vector<std::string>& output);
+    // divide strings into tokens, which are separated by whitespace or commas
+    // everything after # is a comment
+    void tokenize(std::string_view input, std::vector<std::string_view>& output) const;
 
-    // divide strings into tokens, which are separated by whitespace
-    void tokenize(std::string input, std::vector<std::string>& output);
+    // the whole input, once parse_file has read it
+    std::string_view text() const { return std::string_view(contents, contents_size); }
 
-    void remove_comments(std::vector<std::string>& input);
-    void remove_commas(std::vector<std::string>& input);
+    const std::string& name() const { return filename; }
 
 private:
+    void read_file(); // sets contents, throws if the file can't be read
+
+    // regular files are mapped, pipes and the standard input are read into buffer
+    bool map_file(int fd, size_t size);
+    bool read_stream(int fd); // false on a read error
+
+    static bool is_separator(char c);
+
     std::string filename;
+
+    const char* contents; // whole input
+    size_t contents_size;
+
+    void* mapping; // nullptr if the input was not mapped
+    std::string buffer;
+    bool text_given; // by use_text
 };
 
-#endif
\ No newline at end of file
+// add the file names listed in a response file (@file), separated by whitespace
+bool read_response_file(const std::string& filename, std::vector<std::string>& inputs);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _PASS_H_
+#define _PASS_H_
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parser.h"
+#include "lexer.h"
+#include "object.h"
+#include "isa.h"
+
+// what every pass over the source needs: the tokens of the current line,
+// the token being read, the line number for error messages and the operand helpers
+class Pass
+{
+protected:
+    Pass(Parser* _parser);
+
+    // helper functions
+    int extract_register_num(std::string_view token); // get register number, ex. r3 => 3
+    std::string form_expression(); // concat register indirect addressing to one string with no spaces
+    int literal_to_number(std::string_view literal); // convert a literal (hex or decimal) to an integer
+
+    void end_handler(); // .end, same in every pass
+
+
+    // member variables
+    Parser* parser;
+
+    std::string current_section;
+    int current_section_id; // current_section in the string pool
+    int current_section_index; // -1 before the first .section
+
+    uint line_counter; // current line
+    uint token_counter; // current token in line
+
+    std::vector<std::string_view> line_tokens; // current line tokens
+
+    bool end_reached; // stop the compilation
+
+    // constants used
+
+    // code before the first .section
+    const std::string BLANK_SECTION = "BLANK";
+};
+
+#endif
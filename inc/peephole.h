@@ -0,0 +1,83 @@
+#ifndef _PEEPHOLE_H_
+#define _PEEPHOLE_H_
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+#include "scanner.h"
+#include "symbol_table.h"
+
+// an optional stage between the passes, it looks at the instructions of the
+// source in order and removes or rewrites sequences that do nothing:
+//   push rX; pop rX              both removed
+//   push rX; pop rY              ldr rY, rX
+//   ldr rX, rX                   removed
+//   ldr rX, a; ldr rX, a         the second one removed, a is $value or a register
+//   ldr rX, a; ldr rX, b         the first one removed if b does not read rX
+//   jmp/jeq/jne/jgt next         removed if next is the label of the next instruction
+// a label or a directive between two instructions keeps them apart, the second
+// one may be jumped to; registers are r0-r5, r6 and r7 are the sp and the pc
+//
+// lines keep their index so errors keep their line numbers: a removed line is
+// left with its label, a rewritten one points at text kept here; the symbols
+// after a removed byte move back and the sections get shorter, the second pass
+// then writes the code and its relocations at the new offsets
+// addresses written as literals (jmp 0x10, .word 0x10) are not changed
+class Peephole
+{
+public:
+    Peephole(SymbolTable& _symbol_table, std::vector<Section>& _sections);
+
+    // what was removed from one section
+    struct Saving
+    {
+        int section; // string pool id
+        uint instructions;
+        uint bytes;
+    };
+
+    // lines [0, last) after the first pass, the first one is in the given section
+    void optimize(Parser* parser, std::vector<std::string_view>& lines, size_t last, int section);
+
+    // one entry for every section that has instructions, in order of appearance
+    const std::vector<Saving>& savings() const { return saved; }
+
+    void clear(); // forget the rewritten lines of the last source
+
+private:
+    // an instruction that is still there, since the last label or directive
+    struct Kept
+    {
+        size_t line;
+        uint offset; // in its section, before anything was removed
+        uint size;
+        const Instruction* instruction;
+        int reg; // regD of ldr and str, the register of push and pop
+        OperandMode mode; // of the ldr and str operand
+        int base; // its register, REG_* modes only
+        std::string text; // the operand with no spaces
+        std::string_view label; // the start of the line up to its label, empty if it has none
+    };
+
+    static int extract_register(std::string_view token); // rX => X
+
+    bool is_move(const Kept& k) const; // ldr rX from $value or a register, it only sets rX
+    bool reads(const Kept& k, int reg) const; // the operand of a load uses the register
+
+    void remove(const Kept& k, int section);
+    void rewrite(const Kept& k, std::string text);
+    void move_symbols(); // shift the symbols and shorten the sections by what was removed
+    Saving& saving(int section); // added if the section has none yet
+
+    SymbolTable& symbol_table;
+    std::vector<Section>& sections;
+
+    std::vector<std::string_view>* source; // lines being optimized
+
+    std::unordered_map<int, std::vector<std::pair<uint, uint> > > cuts; // offset and size of removed bytes, by section
+    std::vector<Saving> saved;
+    std::deque<std::string> rewritten; // text of rewritten lines, the deque keeps it in place
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef _RELOCATION_TABLE_H_
+#define _RELOCATION_TABLE_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+
+typedef unsigned int uint;
+
+enum class RelocationType : uint8_t
+{
+    ABSOLUTE_16, // R_HYPO_16, the symbol value
+    PCREL_16     // R_HYPO_PC16, the symbol value relative to the pc
+};
+
+const char* relocation_name(RelocationType type);
+
+// relocation records in one bucket per section, a section is its index in the section list
+// records are appended to the bucket of their section as they are written, one column per field
+class RelocationTable
+{
+public:
+    RelocationTable();
+
+    // offset of the word to patch in the section, returns the record index in the bucket
+    int add(int section, uint32_t offset, RelocationType type, int32_t symbol);
+
+    // all records of another table, its section s goes to sections[s] with offsets moved by bases[s]
+    void append(const RelocationTable& part, const std::vector<int>& sections, const std::vector<uint>& bases);
+
+    size_t size() const; // records of all sections
+    size_t size(int section) const { return section < buckets.size() ? buckets[section].offsets.size() : 0; }
+    uint32_t offset(int section, int i) const { return buckets[section].offsets[i]; }
+    RelocationType type(int section, int i) const { return buckets[section].types[i]; }
+    int32_t symbol(int section, int i) const { return buckets[section].symbols[i]; }
+
+    void set_symbol(int section, int i, int32_t symbol) { buckets[section].symbols[i] = symbol; }
+
+    // records with this symbol are taken out by remove_dropped
+    static const int32_t DROPPED = -2;
+    void remove_dropped();
+
+    // sections with records, in the order their first record was added
+    std::vector<int> sections() const;
+
+    // every bucket in offset order, records at the same offset keep their order
+    void sort();
+
+    void clear(); // remove every record, the memory is kept
+
+private:
+    struct Bucket
+    {
+        Column<uint32_t> offsets;
+        Column<RelocationType> types;
+        Column<int32_t> symbols;
+        Column<uint32_t> sequences; // when the record was added, orders the buckets
+        bool sorted; // offsets never went down
+
+        Bucket(Arena& arena) : offsets(arena), types(arena), symbols(arena), sequences(arena), sorted(true)
+        {}
+
+        void push_back(uint32_t offset, RelocationType type, int32_t symbol, uint32_t sequence);
+    };
+
+    Bucket& bucket(int section); // added if missing
+
+    Arena arena;
+
+    std::deque<Bucket> buckets; // by section index
+    uint32_t count; // records added so far
+};
+
+#endif
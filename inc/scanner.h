@@ -0,0 +1,73 @@
+#ifndef _SCANNER_H_
+#define _SCANNER_H_
+
+#include "pass.h"
+
+// symbol found by the first pass, defined later in source order
+struct ScanEvent
+{
+    enum Kind {LABEL, SECTION, EXTERN, EQU, GLOBAL, SKIP};
+
+    Kind kind;
+    std::string name;
+    long value; // label: offset in the section run, section: size of the run it ends, equ: value, skip: size
+    uint line;
+
+    ScanEvent(Kind _kind, std::string _name, long _value, uint _line) :
+    kind(_kind), name(_name), value(_value), line(_line)
+    {}
+};
+
+// the first pass: checks the syntax and counts the size of every line
+// the symbol table is not touched, offsets are counted from the last
+// .section in the range (a section run), so ranges of lines can be
+// scanned at the same time and added up afterwards
+class Scanner : public Pass
+{
+public:
+    Scanner(Parser* _parser);
+
+    // scan lines [first, last), stops after .end
+    void scan(const std::vector<std::string_view>& lines, size_t first, size_t last);
+
+    // scan the next line, true if it has a directive or an instruction
+    bool scan_line(std::string_view line);
+
+    const std::vector<ScanEvent>& events() const { return scan_events; }
+    uint run_size() const { return location_counter; } // bytes since the last .section
+    bool end() const { return end_reached; }
+    size_t end_line() const { return end_line_number; } // line of .end, 0 if not found
+
+    // tokens of the last scanned line and the first one after its label
+    const std::vector<std::string_view>& tokens() const { return line_tokens; }
+    uint statement_token() const { return first_token; }
+
+    void clear(); // drop the events and start a new run
+
+private:
+    void label_handler();
+    void directive_handler();
+    void instruction_handler();
+
+    // directive handlers first pass
+    void extern_handler_fp();
+    void section_handler_fp();
+    void word_handler_fp();
+    void skip_handler_fp();
+    void equ_handler_fp();
+    void global_handler_fp();
+
+    uint operand_size(const Operand& op, const Instruction& instruction); // instruction size for an addressing mode, 0 if invalid
+
+
+    // the 16 bit address space, no .skip can be larger
+    static const int ADDRESS_SPACE = 0x10000;
+
+    uint location_counter; // in the current section run
+    uint first_token;
+    size_t end_line_number;
+
+    std::vector<ScanEvent> scan_events;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// a warm assembler process on a Unix domain socket, so a build step does not
+// start a new process for every file; every message is a list of fields
+// "name length\n" followed by length bytes
+// request: cwd, one arg per argument, source (the client's standard input,
+// when an input is "-"), stop, then end
+// reply: out and err (what the client prints to its stdout and stderr), then status
+
+// accept requests until one asks to stop, each one is run on a pool of threads;
+// returns the exit status of the server
+int serve(const std::string& socket_path, uint threads);
+
+// send the arguments to a server and print its reply, returns the status of the run
+int send_request(const std::string& socket_path, const std::vector<std::string>& args, bool stop);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef _SHA256_H_
+#define _SHA256_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// SHA-256 (FIPS 180-4), names the objects in the cache by their inputs
+class Sha256
+{
+public:
+    Sha256();
+
+    void update(std::string_view data);
+    std::string hex_digest(); // 64 lowercase hex digits, no more updates after it
+
+private:
+    void compress(const uint8_t* block);
+
+    uint32_t state[8];
+    uint8_t block[64];
+    size_t block_size; // bytes waiting in block
+    uint64_t total; // bytes hashed
+};
+
+#endif
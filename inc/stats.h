@@ -0,0 +1,66 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+// what --stats reports: phase times and totals are always measured, they cost
+// a few clock reads per file; the hot path counters only exist in a build with
+// -DASSEMBLER_STATS (make STATS=1), otherwise STAT_ADD is empty
+
+enum class Counter
+{
+    TOKENS,         // produced by Parser::tokenize
+    OPERANDS,       // classified by the lexer
+    SYMBOL_LOOKUPS, // SymbolTable::find calls
+    PROBES,         // string pool slots looked at by those lookups and by inserts
+    COUNT
+};
+
+#ifdef ASSEMBLER_STATS
+// shared by every thread and every file of the process
+inline std::atomic<uint64_t> stat_counters[(int)Counter::COUNT];
+
+#define STAT_ADD(counter, n) stat_counters[(int)Counter::counter].fetch_add((n), std::memory_order_relaxed)
+#else
+#define STAT_ADD(counter, n) ((void)0)
+#endif
+
+struct Stats
+{
+    // wall time in seconds, one pass counts all of its work as first pass
+    double read = 0;
+    double first_pass = 0;
+    double second_pass = 0;
+    double output = 0;
+    double peephole = 0; // between the passes, if it ran
+
+    uint64_t files = 0;
+    uint64_t cached = 0; // files copied from the object cache, only read counts for them
+    uint64_t lines = 0;
+    uint64_t symbols = 0;
+    uint64_t relocations = 0;
+    uint64_t bytes = 0; // machine code, zero runs included
+
+    // what the peephole stage removed, by section name; empty if it did not run
+    struct Saving
+    {
+        uint64_t instructions = 0;
+        uint64_t bytes = 0;
+    };
+    std::map<std::string, Saving> saved;
+
+    void add(const Stats& other); // sum of several files
+};
+
+// wall time since start, for the phase times
+double seconds_since(std::chrono::steady_clock::time_point start);
+
+// a table for people, or one JSON object
+void print_stats(std::ostream& out, const Stats& stats, bool json);
+
+#endif
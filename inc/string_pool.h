@@ -0,0 +1,46 @@
+#ifndef _STRING_POOL_H_
+#define _STRING_POOL_H_
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "arena.h"
+#include "stats.h"
+
+// every distinct name once, labels and section names are referenced by
+// their id, which is the order they were first seen in
+class StringPool
+{
+public:
+    StringPool();
+
+    // id of the name, added if it is new
+    int intern(std::string_view text);
+    // -1 if the name was never interned
+    int find(std::string_view text) const;
+
+    std::string_view name(int id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+    void clear(); // forget every name, the memory is kept
+
+private:
+    struct Slot
+    {
+        uint32_t hash;
+        int id; // -1 for an empty slot
+    };
+
+    static uint32_t hash(std::string_view text);
+    // slot holding the name, or the empty slot where it would go
+    size_t probe(std::string_view text, uint32_t h) const;
+    void grow();
+
+    Arena arena;
+
+    Column<std::string_view> names;
+    std::vector<Slot> slots; // size is a power of two, at most half full
+};
+
+#endif
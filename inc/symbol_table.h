@@ -0,0 +1,60 @@
+#ifndef _SYMBOL_TABLE_H_
+#define _SYMBOL_TABLE_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "arena.h"
+#include "string_pool.h"
+#include "stats.h"
+
+// symbols in definition order, a symbol is its position in that order, which never changes
+// labels and section names are ids in a string pool shared with the rest of the assembler,
+// the fields are kept one column each
+class SymbolTable
+{
+public:
+    // section ids the table starts with, the pool it gets has to be empty
+    static const int UNDEFINED_SECTION = 0; // "UND", extern symbols
+    static const int ABSOLUTE_SECTION = 1; // "ABS", equ symbols
+
+    SymbolTable(StringPool& _names);
+
+    const StringPool& names() const { return pool; }
+
+    // id of a section name, added if it is new
+    int section_id(std::string_view name) { return pool.intern(name); }
+    std::string_view section_name(int id) const { return pool.name(id); }
+
+    // returns -1 if a symbol with the same label already exists
+    int insert(std::string_view label, int section, int32_t offset, char scope);
+    // -1 if there is no such symbol
+    int find(std::string_view label) const;
+
+    size_t size() const { return labels.size(); }
+    std::string_view label(int i) const { return pool.name(labels[i]); }
+    int section(int i) const { return sections[i]; }
+    int32_t offset(int i) const { return offsets[i]; }
+    char scope(int i) const { return scopes[i]; }
+
+    void set_scope(int i, char scope) { scopes[i] = scope; }
+    void set_offset(int i, int32_t offset) { offsets[i] = offset; } // code before it got shorter
+
+    // remove every symbol, the pool has to be cleared first so UND and ABS get their ids again
+    void clear();
+
+private:
+    StringPool& pool;
+    Arena arena;
+
+    Column<int32_t> labels;
+    Column<int32_t> sections;
+    Column<int32_t> offsets;
+    Column<char> scopes;
+
+    std::vector<int> symbol_of; // symbol for each pool id, -1 if the name is not a label
+};
+
+#endif
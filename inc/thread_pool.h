@@ -0,0 +1,71 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+typedef unsigned int uint;
+
+// fixed set of worker threads with a work stealing scheduler
+// every thread has its own queue of tasks, it takes the newest task from
+// its own queue and idle threads steal the oldest ones from the others
+class ThreadPool
+{
+public:
+    // 0 uses one thread per core, the calling thread counts as one of them
+    ThreadPool(uint threads = 0);
+    ~ThreadPool();
+
+    // calls task(i) for every i in [0, count) and returns once all calls are done
+    // it can be called from inside a task, the waiting thread runs other tasks meanwhile
+    // if calls throw, the exception of the lowest i is rethrown
+    void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+    uint size() const { return workers.size() + 1; }
+
+private:
+    // tasks of one parallel_for call
+    struct Batch
+    {
+        const std::function<void(size_t)>* task;
+        std::atomic<size_t> pending; // calls not finished yet
+
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        size_t error_index;
+    };
+
+    struct Task
+    {
+        Batch* batch;
+        size_t index;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(uint id);
+    uint own_queue() const; // queue of the calling thread, threads outside the pool share the last one
+    bool run_one(uint id); // run a task from the own queue or a stolen one, false if there was none
+    void run(const Task& task);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue> > queues;
+
+    std::mutex mutex; // guards sleeping and waking up
+    std::condition_variable wake;
+    std::atomic<size_t> queued; // tasks in all queues
+    bool stopping;
+};
+
+#endif
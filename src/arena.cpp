@@ -0,0 +1,43 @@
+#include "../inc/arena.h"
+
+Arena::Arena() : first_block_size(0), next(nullptr), left(0)
+{
+}
+
+void* Arena::allocate(size_t size, size_t align)
+{
+    size_t padding = (align - (size_t)next % align) % align;
+    if(padding + size > left)
+    {
+        // big requests get a block of their own
+        size_t block = size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE;
+        blocks.push_back(std::unique_ptr<char[]>(new char[block]));
+        if(blocks.size() == 1)
+            first_block_size = block;
+        next = blocks.back().get();
+        left = block;
+        padding = (align - (size_t)next % align) % align;
+    }
+
+    void* result = next + padding;
+    next += padding + size;
+    left -= padding + size;
+    return result;
+}
+
+void Arena::clear()
+{
+    if(blocks.empty())
+        return;
+
+    blocks.resize(1);
+    next = blocks.front().get();
+    left = first_block_size;
+}
+
+std::string_view Arena::copy(std::string_view text)
+{
+    char* data = (char*)allocate(text.size(), 1);
+    memcpy(data, text.data(), text.size());
+    return std::string_view(data, text.size());
+}
@@ -1,1331 +1,652 @@
-
+#include <filesystem>
 
 #include "../inc/assembler.h"
 
-Assembler::Assembler(Parser* _parser, std::string _output_file) : parser(_parser), line_counter(1), location_counter(0),
-token_counter(0), current_section("BLANK"), end_reached(false), output_file(_output_file)
+// a symbol table column, right aligned in 15 characters; a longer name still
+// gets a space before it, the readers split the line on spaces
+static void print_column(std::ofstream& outfile, std::string_view name)
 {
-    parser->parse_file(lines);
+    if(name.size() >= 15)
+        outfile << ' ' << name;
+    else
+        outfile << std::setw(15) << name;
 }
 
-Assembler::~Assembler()
+Assembler::Assembler(Parser* _parser, std::string _output_file) : Pass(_parser), location_counter(0), symbol_table(names), peephole(symbol_table, sections), encoded_lines(0),
+encoder(nullptr), threads(0), thread_pool(nullptr), own_thread_pool(false), output_file(_output_file)
 {
-    for(Symbol* s : symbol_table)
-        delete s;
-    symbol_table.clear();
-
-    for(RelRecord* r : relocation_table)
-        delete r;
-    relocation_table.clear();
-
-    lines.clear();
-    line_tokens.clear();
-    output.clear();
+    read_input();
 }
 
-void Assembler::first_pass()
+Assembler::Assembler() : Pass(nullptr), location_counter(0), symbol_table(names), peephole(symbol_table, sections), encoded_lines(0),
+encoder(nullptr), threads(0), thread_pool(nullptr), own_thread_pool(false)
 {
-    location_counter = 0;
-    line_counter = 1;
-    end_reached = false;
-
-    for(std::string line : lines)
-    {
-        // ignore empty lines
-        if(line.empty())
-        {
-            line_counter++;
-            continue;
-        }
-
-        line_tokens.clear();
-        parser->tokenize(line, line_tokens); 
-        token_counter = 0;
-
-        // just a comment, go to next line
-        if(line_tokens.size() == 0){
-            line_counter++;
-            continue;
-        }
-
-        label_handler();
-        // reached eol
-        if(token_counter == line_tokens.size())
-        {
-            line_counter++;
-            continue;
-        }
-
-        directive_handler();
-        // reached eol
-        if(token_counter == line_tokens.size() || end_reached)
-        {
-            line_counter++;
-            continue;
-        }
-
-        instruction_handler();
-
-        line_counter++;
-
-        if(end_reached)
-            break;
-    }
 }
 
-void Assembler::label_handler()
+void Assembler::load(Parser* _parser)
 {
-    // no label in this line
-    if(line_tokens.at(token_counter).back() != ':')
-        return;
+    // a one pass run that stopped with an error leaves its encoder
+    delete encoder;
+    encoder = nullptr;
 
-    std::string label = line_tokens.at(token_counter);
-    // remove ':'
-    label.erase(std::remove(label.begin(), label.end(), ':'), label.end());
+    parser = _parser;
+    lines.clear();
+    sections.clear();
+    names.clear();
+    symbol_table.clear();
+    relocation_table.clear();
+    peephole.clear();
+    pending_globals.clear();
+    section_starts.clear();
+    encoded_lines = 0;
+    location_counter = 0;
+    statistics = Stats();
 
-    symbol_table.push_back(new Symbol(label, current_section, location_counter, 'l', symbol_table.size()));
-    token_counter++;
+    read_input();
 }
 
-void Assembler::directive_handler()
+void Assembler::read_input()
 {
-    // no directive in this line
-    if(line_tokens.at(token_counter).at(0) != '.')
-        return;
-
-    std::string directive = line_tokens.at(token_counter);
-
-    // mneumonic read, go next token
-    token_counter++;
-    
-    if(directive == GLOBAL_DIRECTIVE)
-    {
-        global_handler_fp();
-    }
-    else if(directive == EXTERN_DIRECTIVE)
-    {
-        extern_handler_fp();
-    }
-    else if(directive == SECTION_DIRECTIVE)
-    {
-        section_handler_fp();
-    }
-    else if(directive == WORD_DIRECTIVE)
-    {
-        word_handler_fp();
-    }
-    else if(directive == SKIP_DIRECTIVE)
-    {
-        skip_handler_fp();
-    }
-    else if(directive == EQU_DIRECTIVE){
-        equ_handler_fp();
-    }
-    else if(directive == END_DIRECTIVE){
-        end_handler_fp();
-    }
-    else
-    {
-        std::cout << "ERROR in line " << line_counter << ", unkown directive: " << directive << std::endl;
-        exit(1);
-    }
+    auto start = std::chrono::steady_clock::now();
+    parser->parse_file(lines);
+    expand_includes();
+    statistics.read = seconds_since(start);
 }
 
-void Assembler::extern_handler_fp()
+void Assembler::expand_includes()
 {
+    origins.clear();
+    included.clear();
 
-    if(token_counter == line_tokens.size())
-    {
-        std::cout << "ERROR in line " << line_counter << ", no symbol list found" << std::endl;
-        exit(1);
-    }
-
-    // add the extern symbols to symbol table
-    while(token_counter < line_tokens.size())
-    {
-        // offset should be 0, section undefined
-        symbol_table.push_back(new Symbol(line_tokens.at(token_counter), UNDEFINED_SECTION, 0, 'g', symbol_table.size()));
-        token_counter++;
-    }
-}
-
-void Assembler::section_handler_fp(){
-    if(line_tokens.size() - token_counter != 1)
-    {
-        std::cout << "ERROR in line " << line_counter << ", junk after section name detected" << std::endl;
-        exit(1);
-    }
-
-    // update current section and remove '.'
-    current_section = line_tokens.at(token_counter);
-    current_section.erase(std::remove(current_section.begin(), current_section.end(), '.'), current_section.end());
-    
-    // reset lc on section change
-    location_counter = 0;
-
-    symbol_table.push_back(new Symbol(current_section, current_section, location_counter, 'l', symbol_table.size()));
+    // most inputs include nothing, their lines stay the ones the parser split
+    if(parser->text().find(".include") == std::string_view::npos)
+        return;
 
-    // section name read, go next token
-    token_counter++;
+    std::vector<std::string_view> input;
+    input.swap(lines);
+    std::vector<std::string> stack(1, IncludeCache::normalize(parser->name()));
+    include_lines(input, parser->name(), stack);
 }
 
-void Assembler::word_handler_fp()
+void Assembler::include_lines(const std::vector<std::string_view>& source, const std::string& file, std::vector<std::string>& stack)
 {
-    if(token_counter == line_tokens.size())
+    // lines of an included file are named by the file in error messages
+    auto where = [&](size_t i)
     {
-        std::cout << "ERROR in line " << line_counter << ", no word symbol list detected" << std::endl;
-        exit(1);
-    }
-            //std::regex literal("^(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
+        return std::to_string(i + 1) + (stack.size() > 1 ? " of " + file : "");
+    };
 
-    // check if literal or symbol list
-    if(std::regex_match(line_tokens.at(token_counter), WORD_LITERAL_REGEX))
+    std::vector<std::string_view> tokens;
+    size_t copied = 0;
+    for(size_t i = 0; i <= source.size(); i++)
     {
-        token_counter++;
-        if(token_counter != line_tokens.size())
+        if(i < source.size())
         {
-            std::cout << "ERROR in line " << line_counter << ", junk after literal found" << std::endl;
-            exit(1);
+            if(source[i].find(".include") == std::string_view::npos)
+                continue;
+            tokens.clear();
+            parser->tokenize(source[i], tokens);
+            if(tokens.empty() || tokens.front() != ".include")
+                continue;
         }
-        location_counter += 2;
-    }
-    else
-    {
-                //std::regex simbol("^[a-zA-Z]\\w*$");
-        // for each symbol check if format is correct
-        while(token_counter < line_tokens.size())
+
+        if(copied < i)
         {
-            if(!std::regex_match(line_tokens.at(token_counter), WORD_SYMBOL_REGEX))
-            {
-                std::cout << "ERROR in line " << line_counter << ",  " << line_tokens.at(token_counter) << " is not a symbol" << std::endl;
-                exit(1);                          
-            }
-            token_counter++;
-            location_counter += 2;
+            origins.push_back(LineOrigin{lines.size(), file, (uint)copied + 1});
+            lines.insert(lines.end(), source.begin() + copied, source.begin() + i);
         }
-    }
-}
+        copied = i + 1;
+        if(i == source.size())
+            break;
 
-void Assembler::skip_handler_fp()
-{
-    if(token_counter == line_tokens.size())
-    {
-        std::cout << "ERROR in line " << line_counter << ", no literal detected after skip" << std::endl;
-        exit(1);
-    }
+        std::string_view name = tokens.size() == 2 ? tokens.at(1) : std::string_view();
+        if(name.size() < 3 || name.front() != '"' || name.back() != '"')
+            throw AssemblerError() << "ERROR in line " << where(i) << ", .include takes one file name in quotes";
 
-    std::string temp_token = line_tokens.at(token_counter);
-    int offset;
-    
-    // check for hex value
-    offset = literal_to_number(temp_token);
+        // relative to the directory of the including file, the stack has the
+        // normalized paths so a file that names itself another way is found
+        std::string path = (std::filesystem::path(file).parent_path() / name.substr(1, name.size() - 2)).string();
+        std::string normal = IncludeCache::normalize(path);
+        if(std::find(stack.begin(), stack.end(), normal) != stack.end())
+            throw AssemblerError() << "ERROR in line " << where(i) << ", " << path << " includes itself";
 
-    // update lc by the number of bytes skipped
-    location_counter += offset;
+        std::shared_ptr<const IncludeFile> include = IncludeCache::shared().get(path);
+        if(std::find(included.begin(), included.end(), include) == included.end())
+            included.push_back(include);
 
-    token_counter++;
+        stack.push_back(normal);
+        include_lines(include->lines, path, stack);
+        stack.pop_back();
+    }
 }
 
-void Assembler::equ_handler_fp()
+AssemblerError Assembler::located(const AssemblerError& error) const
 {
-    if(line_tokens.size() - token_counter != 2)
-    {
-        std::cout << "ERROR in line " << line_counter << ", .equ directive syntax error" << std::endl;
-        exit(1);
-    }
-
-    // .equ symbol_name, symbol_value
-    std::string symbol_label = line_tokens.at(token_counter);
-    token_counter++;
+    if(origins.empty())
+        return error;
 
-    std::string symbol_literal = line_tokens.at(token_counter);
-    int offset;
+    // messages say "ERROR in line N" or "ERROR IN LINE N"
+    std::string message = error.what();
+    size_t at = message.find("line ");
+    if(at == std::string::npos)
+        at = message.find("LINE ");
+    if(at == std::string::npos)
+        return error;
 
-    // convert literal to integer
-    offset = literal_to_number(symbol_literal);
+    size_t digits = at + 5, end = digits;
+    while(end < message.size() && isdigit((unsigned char)message[end]))
+        end++;
+    if(end == digits)
+        return error;
 
-    symbol_table.push_back(new Symbol(symbol_label, ABSOLUTE_SECTION, offset, 'l', symbol_table.size()));
+    size_t index = std::stoul(message.substr(digits, end - digits)) - 1;
+    auto origin = std::upper_bound(origins.begin(), origins.end(), index,
+        [](size_t i, const LineOrigin& o) { return i < o.first; });
+    if(origin == origins.begin())
+        return error;
+    origin--;
 
-    token_counter++;
+    AssemblerError moved;
+    moved << message.substr(0, digits) << origin->line + (index - origin->first);
+    if(origin->file != parser->name())
+        moved << " of " << origin->file;
+    moved << message.substr(end);
+    return moved;
 }
 
-void Assembler::end_handler_fp()
+Assembler::~Assembler()
 {
-    //token_counter++;
-    end_reached = true;
+    delete encoder;
+    if(own_thread_pool)
+        delete thread_pool;
+
+    lines.clear();
+    line_tokens.clear();
+    sections.clear();
 }
 
-void Assembler::global_handler_fp()
+void Assembler::set_threads(uint _threads)
 {
-    while(token_counter < line_tokens.size()){
-        if(!std::regex_match(line_tokens.at(token_counter), WORD_SYMBOL_REGEX))
-        {
-            std::cout << "ERROR in line" << line_counter << ", syntax error";
-            exit(1);
-        }
-        token_counter++;
-    }
+    threads = _threads;
 }
 
-void Assembler::instruction_handler()
+void Assembler::set_thread_pool(ThreadPool* pool)
 {
-    std::string instruction_mneumonic = line_tokens.at(token_counter);
-
-    if(
-        instruction_mneumonic == HALT_MNE ||
-        instruction_mneumonic == IRET_MNE ||
-        instruction_mneumonic == RET_MNE
-    )
-    {
-        // this is a one word instruction, more words => syntax error
-        if(line_tokens.size() - token_counter != 1)
-        {
-            std::cout << "ERROR IN LINE " << line_counter << ", junk after " << instruction_mneumonic << std::endl;
-            exit(1);
-        }
+    thread_pool = pool;
+    threads = pool->size();
+}
 
-        location_counter++;
-        token_counter++;
+void Assembler::first_pass()
+{
+    auto start = std::chrono::steady_clock::now();
+    location_counter = 0;
+    line_counter = 1;
+    end_reached = false;
+    current_section = BLANK_SECTION;
+    current_section_index = -1;
+    current_section_id = symbol_table.section_id(current_section);
+    section_starts.clear();
+    encoded_lines = lines.size();
 
-        return;
-    }
-    else if(
-        //xchg, add, sub, mul, div, cmp, and, or, xor, test, shl, shr
-        instruction_mneumonic == XCHG_MNE ||
-        instruction_mneumonic == ADD_MNE ||
-        instruction_mneumonic == SUB_MNE ||
-        instruction_mneumonic == MUL_MNE ||
-        instruction_mneumonic == DIV_MNE ||
-        instruction_mneumonic == CMP_MNE ||
-        instruction_mneumonic == AND_MNE ||
-        instruction_mneumonic == OR_MNE ||
-        instruction_mneumonic == XOR_MNE ||
-        instruction_mneumonic == TEST_MNE ||
-        instruction_mneumonic == SHL_MNE ||
-        instruction_mneumonic == SHR_MNE 
-    )
+    if(threads != 1 && lines.size() > CHUNK_LINES)
     {
-        token_counter++;
-
-        // there should be 2 operands, regD and regS
-        if(line_tokens.size() - token_counter != 2)
-        {
-            std::cout << "ERROR IN LINE " << line_counter << " incorrect operand format" << instruction_mneumonic << std::endl;
-            exit(1);
-        }
-
-                    //std::regex reg("^r[0-5]$");
-        // check first operand
-        if(!std::regex_match(line_tokens.at(token_counter++), REGISTER_INSTRUCTION_REGEX))
-        {
-            std::cout << "ERROR IN LINE " << line_counter << ", must use registers, first operand" << std::endl;
-            exit(1);
-        }
-
-                        //std::regex reg2("^r[0-7]$");
-        // check second operand
-        if(!std::regex_match(line_tokens.at(token_counter++), REGISTER_INSTRUCTION_REGEX))
-        {
-            std::cout << "ERROR IN LINE " << line_counter << " must use register, second operand" << std::endl;
-            exit(1);
-        }
-
-        location_counter += 2;
-        // proveri format operanada
+        scan_parallel();
     }
-    else if(instruction_mneumonic == NOT_MNE || instruction_mneumonic == INT_MNE)
+    else
     {
-        token_counter++;
-
-        if(line_tokens.size() - token_counter != 1)
-        {
-            std::cout << "ERROR IN LINE " << line_counter << ", incorrect operand format" << line_tokens.at(token_counter) << std::endl;
-            exit(1);
-        }
-
-        if(!std::regex_match(line_tokens.at(token_counter++), REGISTER_INSTRUCTION_REGEX))
-        {
-            std::cout << "ERROR IN LINE " << line_counter << ", registers must be used" << std::endl;
-            exit(1);
-        }
-
-        location_counter += 2;
+        Scanner scanner(parser);
+        scanner.scan(lines, 0, lines.size());
+        define_symbols(scanner);
     }
-    else if(
-        //jmp, jeq, jne, jge
-        instruction_mneumonic == JMP_MNE ||
-        instruction_mneumonic == JEQ_MNE ||
-        instruction_mneumonic == JNE_MNE ||
-        instruction_mneumonic == JGT_MNE ||
-        instruction_mneumonic == CALL_MNE
-    )
-    {
-        // branch token read, go next token
-        token_counter++;
-
-        // nije u pitanju registarsko indirektno
-        // treba proveriti sva ostala adresiranja
-        if(line_tokens.at(token_counter).at(0) != '*' || line_tokens.at(token_counter).at(1) != '[')
-        {
-            if(line_tokens.size() - token_counter != 1)
-            {
-                std::cout << "ERROR IN LINE " << line_counter << " incorrect operand format" << line_tokens.at(token_counter) << std::endl;
-                exit(1);
-            }
 
-            std::string temp_token = line_tokens.at(token_counter);
-            if
-            (
-                std::regex_match(temp_token, BRANCH_LITERAL_REGEX) ||
-                std::regex_match(temp_token, BRANCH_SYMBOL_REGEX) ||
-                std::regex_match(temp_token, BRANCH_PCREL_REGEX) ||
-                std::regex_match(temp_token, BRANCH_MEMLITERAL_REGEX) ||
-                (std::regex_match(temp_token, BRANCH_MEMSYMBOL_REGEX) && !std::regex_match(temp_token, BRANCH_REGDIR_REGEX))
-            )
-            {
-                location_counter += 5;
-            }
-            else if(std::regex_match(line_tokens.at(token_counter), BRANCH_REGDIR_REGEX))
-            {
-                location_counter += 3;
-            }
-            else
-            {
-                std::cout << "ERROR IN LINE " << line_counter << "unknown addressing mode" << std::endl;
-                exit(1);
-            }
+    if(current_section_index == -1 && location_counter > 0)
+        open_blank_section();
+    if(current_section_index != -1)
+        sections.at(current_section_index).size = location_counter;
 
-            token_counter++;
-        }
-        else
-        {
-            // concat regind addressing into one string with no spaces
-            std::string expression = form_expression();
+    apply_globals();
+    statistics.first_pass = seconds_since(start);
+}
 
-            if(token_counter != line_tokens.size())
-            {
-                std::cout << "ERROR IN LINE " << line_counter << "eol junk found!" << std::endl;
-                exit(1);
-            }       
+void Assembler::scan_parallel()
+{
+    size_t chunk_count = (lines.size() + CHUNK_LINES - 1) / CHUNK_LINES;
 
-            if(std::regex_match(expression, BRANCH_REGIND_REGEX))
-            {
-                location_counter += 3;
-            }
-            else if
-            (
-                std::regex_match(expression, BRANCH_LITERALREGIND_REGEX) ||
-                std::regex_match(expression, BRANCH_SYMBOLREGIND_REGEX)
-            )
-            {
-                location_counter += 5;
-            }else
-            {
-                std::cout << "ERROR IN LINE " << line_counter << "unknown addressing mode!" << std::endl;
-                exit(1);
-            }
-        }
-    }
-    else if
-    (
-        // load store
-        instruction_mneumonic == LDR_MNE ||
-        instruction_mneumonic == STR_MNE
-    )
+    // lines after .end are not checked, so find it before scanning
+    std::vector<size_t> end_lines(chunk_count, lines.size());
+    workers().parallel_for(chunk_count, [&](size_t i)
     {
-        token_counter++;
-
-        //std::regex first_operand("^r[0-7]$");
-        if(!std::regex_match(line_tokens.at(token_counter++), REGISTER_INSTRUCTION_REGEX))
-        {
-            std::cout << "ERROR IN LINE " << line_counter << ", first operand must be a register" << std::endl;
-            exit(1);
-        }  
-
-        if(token_counter == line_tokens.size())
+        std::vector<std::string_view> tokens;
+        for(size_t j = i * CHUNK_LINES; j < std::min(lines.size(), (i + 1) * CHUNK_LINES); j++)
         {
-            std::cout << "ERROR IN LINE " << line_counter << ", no operand found" << std::endl;
-            exit(1);
-        }  
+            if(lines[j].find(".end") == std::string_view::npos)
+                continue;
 
-        if(line_tokens.at(token_counter).at(0) != '[')
-        {
-            std::string temp_token = line_tokens.at(token_counter);
-            if
-            (
-                std::regex_match(temp_token, LS_LITERAL_REGEX) ||
-                std::regex_match(temp_token, LS_SYMBOL_REGEX) ||
-                std::regex_match(temp_token, LS_MEMLITERAL_REGEX) ||
-                std::regex_match(temp_token, LS_MEMSYMBOL_REGEX) ||
-                std::regex_match(temp_token, LS_PCRELSYMBOL_REGEX)
-            )
-            {
-                location_counter += 5;
-            }
-            else if(std::regex_match(temp_token, LS_REGDIR_REGEX))
+            tokens.clear();
+            parser->tokenize(lines[j], tokens);
+            size_t directive = !tokens.empty() && tokens.front().back() == ':' ? 1 : 0;
+            const Directive* info = directive < tokens.size() ? find_directive(tokens.at(directive)) : nullptr;
+            if(info != nullptr && info->kind == DirectiveKind::END)
             {
-                location_counter += 3;
-            }
-            else
-            {
-                std::cout << "ERROR IN LINE " << line_counter << ", unknown addressing mode" << std::endl;
-                exit(1);
+                end_lines.at(i) = j + 1;
+                break;
             }
         }
-        else
-        {
-            // concat the expression that may contain spaces into one that does not
-            std::string expression = form_expression();
+    });
+    size_t last = *std::min_element(end_lines.begin(), end_lines.end());
+    chunk_count = (last + CHUNK_LINES - 1) / CHUNK_LINES;
 
-            if(token_counter != line_tokens.size())
-            {
-                std::cout << "ERROR IN LINE " << line_counter << ", eol junk found!" << std::endl;
-                exit(1);
-            }       
-            if(std::regex_match(expression, LS_REGIND_REGEX))
-            {
-                location_counter += 3;
-            }
-            else if
-            (
-                std::regex_match(expression, LS_LITERALREGIND_REGEX) ||
-                std::regex_match(expression, LS_SYMBOLREGIND_REGEX)
-            )
-            {
-                location_counter += 5;
-            }else
-            {
-                std::cout << "ERROR IN LINE " << line_counter << ", unknown addressing mode!" << std::endl;
-                exit(1);
-            } 
-        }
-    }
-    else if(instruction_mneumonic == PUSH_MNE || instruction_mneumonic == POP_MNE)
-    {
-        token_counter++;
-        if(!std::regex_match(line_tokens.at(token_counter), REGISTER_INSTRUCTION_REGEX))
-        {
-            std::cout << "ERROR IN LINE " << line_counter << ", a register must be used " <<std::endl;
-            exit(1); 
-        }
-        location_counter += 3;
-    }
-    else
+    // every chunk counts its section runs from 0
+    std::vector<Scanner> scanners(chunk_count, Scanner(parser));
+    workers().parallel_for(chunk_count, [&](size_t i)
     {
-        std::cout << "ERROR IN LINE " << line_counter << "unknown instruction: " <<  instruction_mneumonic <<std::endl;
-        exit(1);     
-    }
+        scanners.at(i).scan(lines, i * CHUNK_LINES, std::min(last, (i + 1) * CHUNK_LINES));
+    });
+
+    // in source order, each run starts where the previous chunk left its section
+    for(const Scanner& scanner : scanners)
+        define_symbols(scanner);
 }
 
-void Assembler::second_pass()
+void Assembler::define_symbols(const Scanner& scanner)
 {
-    // reset all the flags
-    location_counter = 0;
-    line_counter = 1;
-    end_reached = false;
-
-    for(std::string line : lines)
+    for(const ScanEvent& event : scanner.events())
     {
-        // ignore empty lines
-        if(line.empty())
-        {
-            line_counter++;
-            continue;
-        }
-
-        line_tokens.clear();
-        parser->tokenize(line, line_tokens); 
-        token_counter = 0;
-
-        // just a comment line, go next
-        if(line_tokens.size() == 0){
-            line_counter++;
-            continue;
-        }
-
-        // ignore labels
-        if(line_tokens.at(token_counter).back() == ':'){
-            token_counter++;
-        }
-
-        // reached eol
-        if(token_counter == line_tokens.size())
-        {
-            line_counter++;
-            continue;
-        }
-
-        directive_handler_sp();
-
-        // reached eol
-        if(token_counter == line_tokens.size() || end_reached)
+        line_counter = event.line;
+        switch(event.kind)
         {
-            line_counter++;
-            continue;
-        }
-
-        instruction_handler_sp();
-
-        line_counter++;
-        if(end_reached)
+        case ScanEvent::LABEL:
+            define_symbol(event.name, current_section_id, location_counter + event.value, 'l');
             break;
+        case ScanEvent::SECTION:
+            section_switch(event.name, location_counter + event.value);
+            break;
+        case ScanEvent::EXTERN:
+            // offset should be 0, section undefined
+            define_symbol(event.name, SymbolTable::UNDEFINED_SECTION, 0, 'g');
+            break;
+        case ScanEvent::EQU:
+            define_symbol(event.name, SymbolTable::ABSOLUTE_SECTION, event.value, 'l');
+            break;
+        case ScanEvent::SKIP:
+            if(current_section_index == -1)
+                open_blank_section();
+            sections.at(current_section_index).skipped += event.value;
+            break;
+        case ScanEvent::GLOBAL:
+            // the symbol may be defined later, it is marked at the end of the pass
+            pending_globals.push_back(std::make_pair(event.name, event.line));
+            break;
+        }
     }
-    // prints all the data into an output file
-    print_data();
-}
-
-void Assembler::directive_handler_sp()
-{
-    // not a directive
-    if(line_tokens.at(token_counter).at(0) != '.')
-        return;
-
-    // consume directive
-    std::string directive = line_tokens.at(token_counter);
-    token_counter++;
-
-    if(directive == GLOBAL_DIRECTIVE)
-    {
-        global_handler_sp();
-    }
-    else if(directive == SECTION_DIRECTIVE)
-    {
-        section_handler_sp();
-    }
-    else if(directive == WORD_DIRECTIVE)
-    {
-        word_handler_sp();
-    }
-    else if(directive == SKIP_DIRECTIVE)
-    {
-        skip_handler_sp();
-    }
-    else if(directive == EXTERN_DIRECTIVE)
-    {
-        // skip line
-        while(token_counter < line_tokens.size())
-            token_counter++;
-    }
-    else if(directive == EQU_DIRECTIVE)
-    {
-        // skip line
-        while(token_counter < line_tokens.size())
-            token_counter++;
-    }
-    else if(directive == END_DIRECTIVE)
-    {
-        end_handler_fp();
-    }
-}
+    location_counter += scanner.run_size();
 
-void Assembler::global_handler_sp()
-{
-    Symbol* s = find_symbol(line_tokens.at(token_counter));
-    if(s == nullptr)
-    {
-        std::cout << "ERROR in line " << line_counter << ", symbol undefined" << std::endl;
-        exit(1);
-    }
-    // change symbol scope to global
-    s->scope = 'g';
-    token_counter++;
+    if(scanner.end_line() != 0)
+        encoded_lines = scanner.end_line();
 }
 
-Symbol* Assembler::find_symbol(std::string label)
+void Assembler::open_blank_section()
 {
-    for(Symbol* s : symbol_table){
-        if(s->label == label)
-            return s; 
-    }
-    return nullptr;
+    // it is added when its first byte is found, before any named section,
+    // which is when the encoder of the one pass engine adds it too
+    current_section_index = find_section(sections, current_section_id);
 }
 
-void Assembler::section_handler_sp()
+void Assembler::section_switch(const std::string& name, uint end_of_run)
 {
-    // update current section, remove '.', reset lc
-    current_section = line_tokens.at(token_counter);
+    // remember where the section we are leaving ended
+    if(current_section_index == -1 && end_of_run > 0)
+        open_blank_section();
+    if(current_section_index != -1)
+        sections.at(current_section_index).size = end_of_run;
 
-    current_section.erase(std::remove(current_section.begin(), current_section.end(), '.'), current_section.end());
+    current_section = name;
+    current_section_id = symbol_table.section_id(current_section);
+    current_section_index = find_section(sections, current_section_id);
+    section_starts.push_back(std::make_pair(line_counter - 1, current_section_id));
 
-    location_counter = 0;
-    token_counter++;
-}
+    // lc starts from 0 in a new section, a reopened one continues where it ended
+    location_counter = sections.at(current_section_index).size;
 
-void Assembler::word_handler_sp()
-{
-    if(std::regex_match(line_tokens.at(token_counter), WORD_LITERAL_REGEX))
+    // reopening a section does not define it again
+    int symbol = symbol_table.find(current_section);
+    if(symbol == -1)
     {
-        std::string out = "";
-        std::string temp_token = line_tokens.at(token_counter);
-        int val = 0;
-
-        // without outter if, .word 0 would be an error!
-        if(temp_token.size() != 1){
-            if(temp_token.at(0) == '0' && (temp_token.at(1) == 'x' || temp_token.at(1) == 'X'))
-                val = std::stoi(line_tokens.at(token_counter), 0, 16);
-        }
-        else
-            val = std::stoi(line_tokens.at(token_counter));
-        
-        // insert into object code
-        output.push_back(write_hex(val, 4));
-
-        token_counter++;
-        location_counter += 2;
+        define_symbol(current_section, current_section_id, 0, 'l');
     }
-    else
+    else if(symbol_table.section(symbol) != current_section_id || symbol_table.offset(symbol) != 0)
     {
-        while(token_counter < line_tokens.size())
-        {
-            std::string label = line_tokens.at(token_counter);
-            Symbol* tmp = find_symbol(label);
-            if(tmp == nullptr)
-            {
-                std::cout << "ERROR in line " << line_counter << ", one or more symbols undefined" << std::endl;
-                exit(1);
-            }
-            // dodaj u tabelu relokacija, ako nije equ koriscen!
-            if(tmp->section != ABSOLUTE_SECTION)
-                relocation_table.push_back(new RelRecord(tmp->offset, "R_HYP0_16", tmp->index, current_section));
-            
-            int val = tmp->offset;
-            output.push_back(write_hex(val, 4));
-            location_counter += 2;
-            token_counter++;
-        }
+        throw AssemblerError() << "ERROR in line " << line_counter << ", symbol " << current_section << " already defined";
     }
 }
 
-// returns a number in hex format, ex. 16,4 => 00 10
-std::string Assembler::write_hex(int val, int num_of_nibbles)
+ThreadPool& Assembler::workers()
 {
-    int shift_val = (num_of_nibbles - 1) * 4;
-    std::string out = "";
-    int nibble_counter = 0;
-    while(shift_val != -4)
+    if(thread_pool == nullptr)
     {
-        std::stringstream ss;
-        ss << std::hex << ((val >> shift_val) & 0xf);
-        out += ss.str();
-        shift_val -= 4;
-        nibble_counter++;
-        if(nibble_counter % 2 == 0)
-            out += " ";
+        thread_pool = new ThreadPool(threads);
+        own_thread_pool = true;
     }
-    // to upper case
-    transform(out.begin(), out.end(), out.begin(), ::toupper);
-    
-    return out;
+    return *thread_pool;
 }
 
-void Assembler::skip_handler_sp()
+void Assembler::optimize()
 {
-    int val = literal_to_number(line_tokens.at(token_counter));
-
-    // each byte has two nibbles, so val*2
-    output.push_back(write_hex(0, val*2));
-
-    token_counter++;
-    location_counter += val;
-}
+    auto start = std::chrono::steady_clock::now();
+    peephole.optimize(parser, lines, encoded_lines, names.find(BLANK_SECTION));
 
-
-void Assembler::instruction_handler_sp()
-{
-    std::string instruction_mneumonic = line_tokens.at(token_counter);
-    if(instruction_mneumonic == HALT_MNE)
-    {
-        output.push_back("00");
-        token_counter++;
-        location_counter++;
-    }
-    else if(instruction_mneumonic == IRET_MNE)
-    {
-        token_counter++;
-        output.push_back("20");
-        location_counter++;
-    }
-    else if(instruction_mneumonic == RET_MNE)
+    for(const Peephole::Saving& saving : peephole.savings())
     {
-        token_counter++;
-        output.push_back("40");
-        location_counter++;
-    }
-    else if(instruction_mneumonic == INT_MNE)
-    {
-        token_counter++;
-        std::string out = "10 ";
-        out += extract_register_num(line_tokens.at(token_counter));
-        out += "F";
-        location_counter += 2;
-        token_counter++;
-        output.push_back(out);
-    }
-    else if(instruction_mneumonic == XCHG_MNE)
-    {
-        twobyte_handler_sp("60");
-    }
-    else if(instruction_mneumonic == ADD_MNE)
-    {
-        twobyte_handler_sp("70");
-    }
-    else if(instruction_mneumonic == SUB_MNE)
-    {
-        twobyte_handler_sp("71");
-    }
-    else if(instruction_mneumonic == MUL_MNE)
-    {
-        twobyte_handler_sp("72");
-    }
-    else if(instruction_mneumonic == DIV_MNE)
-    {
-        twobyte_handler_sp("73");
-    }
-    else if(instruction_mneumonic == CMP_MNE)
-    {
-        twobyte_handler_sp("74");
-    }
-    else if(instruction_mneumonic == NOT_MNE)
-    {
-        token_counter++;
-        std::string out = "80 ";
-        out += extract_register_num(line_tokens.at(token_counter));
-        out += "0";
-        location_counter += 2;
-        token_counter++;
-        output.push_back(out);
-    }
-    else if(instruction_mneumonic == AND_MNE)
-    {
-        twobyte_handler_sp("81");
-    }
-    else if(instruction_mneumonic == OR_MNE)
-    {
-        twobyte_handler_sp("82");
-    }
-    else if(instruction_mneumonic == XOR_MNE)
-    {
-        twobyte_handler_sp("83");
-    }
-    else if(instruction_mneumonic == TEST_MNE)
-    {
-        twobyte_handler_sp("84");
-    }
-    else if(instruction_mneumonic == SHL_MNE)
-    {
-        twobyte_handler_sp("90");
-    }
-    else if(instruction_mneumonic == SHR_MNE)
-    {
-        twobyte_handler_sp("91");
-    }
-    else if(instruction_mneumonic == JMP_MNE ||
-            instruction_mneumonic == JEQ_MNE ||
-            instruction_mneumonic == JNE_MNE ||
-            instruction_mneumonic == JGT_MNE ||
-            instruction_mneumonic == CALL_MNE
-    )
-    {
-        branch_handler_sp();
-    }
-    else if(instruction_mneumonic == LDR_MNE ||
-            instruction_mneumonic == STR_MNE
-    )
-    {
-        mem_handler_sp();
-    }
-    else if(
-        instruction_mneumonic == PUSH_MNE ||
-        instruction_mneumonic == POP_MNE
-    )
-    {
-        stack_handler_sp();
+        Stats::Saving& saved = statistics.saved[std::string(names.name(saving.section))];
+        saved.instructions += saving.instructions;
+        saved.bytes += saving.bytes;
     }
+    statistics.peephole = seconds_since(start);
 }
 
-// handles instructions sized 2 bytes, needs instruction opcode
-void Assembler::twobyte_handler_sp(std::string opcode)
+void Assembler::second_pass()
 {
-    token_counter++;
-    std::string out = opcode;
-    out += " ";
-
-    // first register
-    out += extract_register_num(line_tokens.at(token_counter));
-    token_counter++;
-    // second register
-    out += extract_register_num(line_tokens.at(token_counter));
+    encode_sections();
 
-    token_counter++;
-    location_counter += 2;
-
-    output.push_back(out);
+    // prints all the data into an output file
+    print_data();
 }
 
-void Assembler::branch_handler_sp()
+void Assembler::encode_sections()
 {
-    std::string opcode;
-    if(line_tokens.at(token_counter) == JMP_MNE)
-        opcode = "50";
-    else if(line_tokens.at(token_counter) == JEQ_MNE)
-        opcode = "51";
-    else if(line_tokens.at(token_counter) == JNE_MNE)
-        opcode = "52";
-    else if(line_tokens.at(token_counter) == JGT_MNE)
-        opcode = "53";
-    else if(line_tokens.at(token_counter) == CALL_MNE)
-        opcode = "30";
-
-    token_counter++;
-
-    std::string out = opcode;
-    out += " ";
-
-    std::string temp_token = line_tokens.at(token_counter);
-
-    // there may be spaces in [r0 + 0x12], so form an expression
-    // mozda ne treba back
-    if(temp_token.at(0) == '*' && temp_token.at(1) == '[' && temp_token.back() != ']')
-        temp_token = form_expression();
-    
-    // immediate literal
-    if(std::regex_match(temp_token, BRANCH_LITERAL_REGEX))
-    {
-        out += "F0 00 ";
-        int val = literal_to_number(line_tokens.at(token_counter));
-        out += write_hex(val, 4);
-        location_counter += 5;
-    }
-    // immediate symbol
-    else if(std::regex_match(temp_token, BRANCH_SYMBOL_REGEX))
+    auto start = std::chrono::steady_clock::now();
+
+    // section sizes are known after the first pass, so each buffer is allocated once
+    for(Section& section : sections)
+        section.data.reserve(section.size - section.skipped);
+
+    if(threads != 1 && encoded_lines > CHUNK_LINES)
     {
-        out += "F0 00 ";
-        Symbol* s = find_symbol(temp_token);
-        if(s == nullptr)
-        {
-            std::cout << "ERROR in line" << line_counter << " symbol " << temp_token << " undefined" << std::endl;
-            exit(1);
-        }
-        out += write_hex(s->offset, 4);
-        // add rel record
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_ABSOLUTE, s->index, current_section));
-        location_counter += 5;
+        encode_parallel();
     }
-    // pc relative symbol
-    else if(std::regex_match(temp_token, BRANCH_PCREL_REGEX))
+    else
     {
-        out += "F7 05 ";
-        std::string symbol_no_percent = temp_token.substr(1);
-        Symbol* s = find_symbol(symbol_no_percent);
-        if(s == nullptr)
-        {
-            std::cout << "ERROR in line" << line_counter << " symbol " << symbol_no_percent << " undefined" << std::endl;
-            exit(1);
-        }
-        out += write_hex(s->offset, 4);
-        // add rel record
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_PCREL, s->index, current_section)); 
-        location_counter += 5;
+        Encoder encoder(parser, symbol_table, sections, relocation_table);
+        encoder.encode(lines, 0, encoded_lines, names.find(BLANK_SECTION));
     }
-    else if(std::regex_match(temp_token, BRANCH_MEMLITERAL_REGEX))
+    statistics.second_pass = seconds_since(start);
+}
+
+void Assembler::encode_parallel()
+{
+    struct Chunk
     {
-        out += "F0 04 ";
-        // remove star before literal then convert to number
-        std::string literal_no_star = temp_token.substr(1);
-        int val = literal_to_number(literal_no_star);
-        out += write_hex(val, 4);
-        location_counter += 5;
-    }
-    else if(std::regex_match(temp_token, BRANCH_MEMSYMBOL_REGEX)  && !std::regex_match(temp_token, BRANCH_REGDIR_REGEX))
+        size_t first, last; // line indexes
+        int section; // section of the first line
+        std::vector<Section> sections;
+    };
+
+    // chunks start at .section lines, long sections are split further
+    std::vector<Chunk> chunks;
+    int section = names.find(BLANK_SECTION);
+    size_t first = 0;
+    for(size_t i = 0; i <= section_starts.size(); i++)
     {
-        out += "F0 04 ";
-        std::string symbol_no_star = temp_token.substr(1);
-        Symbol* s = find_symbol(symbol_no_star);
-        if(s == nullptr)
+        size_t last = i < section_starts.size() ? section_starts.at(i).first : encoded_lines;
+        while(first < last)
         {
-            std::cout << "ERROR in line" << line_counter << " symbol " << symbol_no_star << " undefined" << std::endl;
-            exit(1);
+            size_t next = std::min(last, first + CHUNK_LINES);
+            chunks.push_back(Chunk{first, next, section});
+            first = next;
         }
-        out += write_hex(s->offset, 4);
-        // add rel record
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_ABSOLUTE, s->index, current_section)); 
-        location_counter += 5;
-    }
-    else if(std::regex_match(temp_token, BRANCH_REGDIR_REGEX))
-    {
-        // remove the star before register
-        std::string register_no_star = temp_token.substr(1);
-        out += "F";
-        out += extract_register_num(register_no_star);
-        out += " 01";
-        location_counter += 3;
+        if(i < section_starts.size())
+            section = section_starts.at(i).second;
     }
-    else if(std::regex_match(temp_token, BRANCH_REGIND_REGEX))
-    {
-        std::string reg = extract_between_chars(temp_token, '[', ']');
-        out += "F";
-        out += extract_register_num(reg);
-        out += " 02";
-        location_counter += 3;
-    }
-    else if(std::regex_match(temp_token, BRANCH_LITERALREGIND_REGEX))
-    {
-        out += "F";
-        std::string reg = extract_between_chars(temp_token, '[', '+');
-        int val = literal_to_number(extract_between_chars(temp_token, '+', ']'));
 
-        out += extract_register_num(reg);
-        out += " 03 ";
-        out += write_hex(val, 4);
+    // the tables keep their records in an arena, so they are built in place
+    std::deque<RelocationTable> relocations(chunks.size());
 
-        location_counter += 5;
-    }
-    else if(std::regex_match(temp_token, BRANCH_SYMBOLREGIND_REGEX))
+    // the symbol table is only read, every chunk writes into its own sections
+    workers().parallel_for(chunks.size(), [&](size_t i)
     {
-        out += "F";
-
-        std::string reg = extract_between_chars(temp_token, '[', '+');
-        std::string sym_name = extract_between_chars(temp_token, '+', ']');
+        Chunk& chunk = chunks.at(i);
+        Encoder encoder(parser, symbol_table, chunk.sections, relocations.at(i));
+        encoder.encode(lines, chunk.first, chunk.last, chunk.section);
+    });
 
-        Symbol* s = find_symbol(sym_name);
-        if(s == nullptr)
+    // append the chunks in source order, relocation offsets move by what the section already holds
+    for(size_t i = 0; i < chunks.size(); i++)
+    {
+        std::vector<int> index;
+        std::vector<uint> base;
+        for(Section& part : chunks.at(i).sections)
         {
-            std::cout << "ERROR in line" << line_counter << " symbol " << sym_name << " undefined" << std::endl;
-            exit(1);
+            index.push_back(find_section(sections, part.name));
+            base.push_back(sections.at(index.back()).append(part));
         }
 
-        out += extract_register_num(reg);
-        out += " 03 ";
-        out += write_hex(s->offset, 4);
-
-        // add rel record
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_ABSOLUTE, s->index, current_section)); 
-        location_counter += 5;
+        relocation_table.append(relocations.at(i), index, base);
     }
-
-    output.push_back(out);
 }
 
-std::string Assembler::extract_register_num(std::string token)
+void Assembler::one_pass()
 {
-    std::string res = "";
-    // format ce biti rX, gde je x neki broj
-    res.push_back(token.at(1));
-    return res;
-}
+    scan_and_encode();
 
-std::string Assembler::extract_between_chars(std::string str, char from, char to)
-{
-    int index_from = str.find(from);
-    int index_to = str.find(to);
-    return str.substr(index_from+1, index_to - index_from-1);
+    // prints all the data into an output file
+    print_data();
 }
 
-int Assembler::literal_to_number(std::string literal)
+void Assembler::scan_and_encode()
 {
-    if(literal.at(0) == '0' && (literal.at(1) == 'x' || literal.at(1) == 'X'))
-        return std::stoi(literal, 0, 16);
-    else
-        return std::stoi(literal);
-}
+    auto start = std::chrono::steady_clock::now();
+    location_counter = 0;
+    line_counter = 1;
+    end_reached = false;
+    current_section = BLANK_SECTION;
+    current_section_index = -1;
+    current_section_id = symbol_table.section_id(current_section);
 
-std::string Assembler::form_expression()
-{
-    // handle register indirect address mode
-    if(token_counter == line_tokens.size())
-        return line_tokens.at(token_counter-1);
+    Scanner scanner(parser);
+    encoder = new Encoder(parser, symbol_table, sections, relocation_table);
+    encoder->allow_forward_references();
 
-    std::string expression = line_tokens.at(token_counter);
-    token_counter++;
-    if(expression.back() != ']')
+    for(size_t i = 0; i < lines.size() && !scanner.end(); i++)
     {
-        while(expression.back() != ']')
-        {
-            if(token_counter == line_tokens.size())
-            {
-                std::cout << "ERROR IN LINE " << line_counter << "unknown addressing mode" << std::endl;
-                exit(1);
-            }
-            expression += line_tokens.at(token_counter++);
-        }
-    }
-    //std::cout << "returning " << expression << std::endl;
-    return expression;
-}
+        // every line is checked and counted by the first pass,
+        // its symbols are defined and then the same tokens are encoded
+        bool statement = scanner.scan_line(lines[i]);
+        define_symbols(scanner);
+        scanner.clear();
 
-void Assembler::stack_handler_sp()
-{
-    std::string instruction_mneumonic = line_tokens.at(token_counter);
-    token_counter++;
-    std::string out; 
-    if(instruction_mneumonic == PUSH_MNE)
-    {
-        out = "B0 6";
-        out += extract_register_num(line_tokens.at(token_counter));
-        out += " 22";
-    }
-    else
-    {
-        out = "A0 ";
-        out += extract_register_num(line_tokens.at(token_counter));
-        out += "6 32";
+        if(statement)
+            encoder->encode_line(scanner.tokens(), scanner.statement_token(), i + 1);
     }
 
-    location_counter += 3;
-    token_counter++;
-
-    output.push_back(out);
-}
+    if(current_section_index == -1 && location_counter > 0)
+        open_blank_section();
+    if(current_section_index != -1)
+        sections.at(current_section_index).size = location_counter;
 
+    encoder->finish_fixups();
+    delete encoder;
+    encoder = nullptr;
 
+    apply_globals();
+    statistics.first_pass = seconds_since(start);
+}
 
-void Assembler::mem_handler_sp()
+void Assembler::apply_globals()
 {
-    std::string opcode;
-    if(line_tokens.at(token_counter) == LDR_MNE)
-        opcode = "A0";
-    else if(line_tokens.at(token_counter) == STR_MNE)
-        opcode = "B0";
-
-    token_counter++; 
-
-    std::string out = opcode;
-    out += " ";
-
-
-    // parse first operand
-    std::string first_operand = line_tokens.at(token_counter);
-    out += extract_register_num(first_operand);
-
-    token_counter++;
-    std::string temp_token = line_tokens.at(token_counter);
-
-    // there may be spaces [r0 +0x1], so form and expression
-    // mozda ne treba back
-    if(temp_token.at(0) == '[' && temp_token.back() != ']')
-        temp_token = form_expression();
-
-
-    if(std::regex_match(temp_token, LS_LITERAL_REGEX))
+    for(const auto& global : pending_globals)
     {
-        if(opcode == "B0")
+        int symbol = symbol_table.find(global.first);
+        if(symbol == -1)
         {
-            std::cout << "ERROR in line " << line_counter << ", cannot store to immediate value" << std::endl;
-            exit(1);
+            throw AssemblerError() << "ERROR in line " << global.second << ", symbol " << global.first << " undefined";
         }
-
-        out += "0 00 ";
-
-        // remove $ before literal
-        std::string literal_num = temp_token.substr(1);
-        int val = literal_to_number(literal_num);
-
-        out += write_hex(val, 4);
-        location_counter += 5;
+        // change symbol scope to global
+        symbol_table.set_scope(symbol, 'g');
     }
-    else if(std::regex_match(temp_token, LS_SYMBOL_REGEX))
-    {
-        if(opcode == "B0")
-        {
-            std::cout << "ERROR in line " << line_counter << ", cannot store to immediate value" << std::endl;
-            exit(1);
-        }
-
-        out += "0 00 ";
+    pending_globals.clear();
+}
 
-        std::string sym_name = temp_token.substr(1);
-        Symbol* s = find_symbol(sym_name);
-        if(s == nullptr)
-        {
-            std::cout << "ERROR in line" << line_counter << ", symbol (" << temp_token << ") undefined" << std::endl;
-            exit(1);
-        }
+int Assembler::define_symbol(std::string_view label, int section, int32_t offset, char scope)
+{
+    int symbol = symbol_table.insert(label, section, offset, scope);
+    if(symbol == -1)
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", symbol " << label << " already defined";
+    }
 
-        out += write_hex(s->offset, 4);
+    if(encoder != nullptr)
+        encoder->resolve_fixups(symbol);
+    return symbol;
+}
 
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_ABSOLUTE, s->index, current_section));
-        
-        location_counter += 5;
-    }
-    else if(std::regex_match(temp_token, LS_MEMLITERAL_REGEX))
+void Assembler::export_object(ObjectFile& object)
+{
+    // resize and assign, so the strings and vectors the object has are reused
+    object.sections.resize(sections.size());
+    for(size_t i = 0; i < sections.size(); i++)
     {
-        out += "0 04 ";
-        int val = literal_to_number(temp_token);
-        out += write_hex(val, 4);
-        location_counter += 5;
+        object.sections[i].name = names.name(sections[i].name);
+        sections[i].flatten(object.sections[i].data);
     }
-    else if(std::regex_match(temp_token, LS_MEMSYMBOL_REGEX))
+
+    object.symbols.resize(symbol_table.size());
+    for(size_t i = 0; i < symbol_table.size(); i++)
     {
-        out += "0 04 ";
-        Symbol* s = find_symbol(temp_token);
-        if(s == nullptr)
-        {
-            std::cout << "ERROR in line" << line_counter << " symbol (" << temp_token << ") undefined" << std::endl;
-            exit(1);
-        }
-        out += write_hex(s->offset, 4);
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_ABSOLUTE, s->index, current_section));
-        location_counter += 5;
+        ObjectSymbol& symbol = object.symbols[i];
+        symbol.label = symbol_table.label(i);
+        symbol.section = symbol_table.section_name(symbol_table.section(i));
+        symbol.offset = symbol_table.offset(i);
+        symbol.scope = symbol_table.scope(i);
     }
-    else if(std::regex_match(temp_token, LS_PCRELSYMBOL_REGEX))
+
+    relocation_table.sort();
+    object.relocations.resize(relocation_table.size());
+    size_t next = 0;
+    for(int section : relocation_table.sections())
     {
-        out += "7 03 ";
-        std::string sym_name = temp_token.substr(1);
-        Symbol* s = find_symbol(sym_name);
-        if(s == nullptr)
+        for(size_t i = 0; i < relocation_table.size(section); i++)
         {
-            std::cout << "ERROR in line" << line_counter << " symbol " << temp_token << " undefined" << std::endl;
-            exit(1);
+            ObjectRelocation& relocation = object.relocations[next++];
+            relocation.section = names.name(sections.at(section).name);
+            relocation.offset = relocation_table.offset(section, i);
+            relocation.type = relocation_table.type(section, i);
+            relocation.symbol = relocation_table.symbol(section, i);
         }
-        out += write_hex(s->offset, 4);
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_PCREL, s->index, current_section));
-        location_counter += 5;
     }
-    else if(std::regex_match(temp_token, LS_REGDIR_REGEX))
-    {
-        out += extract_register_num(temp_token);
-        out += " 01";
-        location_counter += 3;
-    }
-    else if(std::regex_match(temp_token, LS_REGIND_REGEX))
-    {
-        std::string reg = extract_between_chars(temp_token, '[', ']');
-        out += extract_register_num(reg);
-        out += " 02";
-        location_counter += 3;
-    }
-    else if(std::regex_match(temp_token, LS_LITERALREGIND_REGEX))
-    {
-        std::string reg = extract_between_chars(temp_token, '[', '+');
-        int val = literal_to_number(extract_between_chars(temp_token, '+', ']'));
+}
 
-        out += extract_register_num(reg);
-        out += " 03 ";
-        out += write_hex(val, 4);
+void Assembler::print_reloc(std::ofstream& outfile)
+{
+    relocation_table.sort();
 
-        location_counter +=5;
-    }
-    else if(std::regex_match(temp_token, LS_SYMBOLREGIND_REGEX))
+    // one buffer per section, written at once
+    std::string text;
+    char number[16];
+    for(int section : relocation_table.sections())
     {
-        std::string reg = extract_between_chars(temp_token, '[', '+');
-        std::string sym_name = extract_between_chars(temp_token, '+', ']');
-        Symbol* s = find_symbol(sym_name);
-        if(s == nullptr)
+        text.clear();
+        text += "\n\n# ------------------ REL.";
+        text += names.name(sections.at(section).name);
+        text += " ------------------\n";
+        for(size_t i = 0; i < relocation_table.size(section); i++)
         {
-            std::cout << "ERROR in line" << line_counter << " symbol " << temp_token << " undefined" << std::endl;
-            exit(1);
+            text.append(number, std::to_chars(number, number + sizeof(number), relocation_table.offset(section, i)).ptr);
+            text += ' ';
+            text += relocation_name(relocation_table.type(section, i));
+            text += ' ';
+            text.append(number, std::to_chars(number, number + sizeof(number), relocation_table.symbol(section, i)).ptr);
+            text += " \n";
         }
-        if(s->section != ABSOLUTE_SECTION)
-            relocation_table.push_back(new RelRecord(location_counter, RELOCATION_ABSOLUTE, s->index, current_section));
-        location_counter += 5;
-
-        out += extract_register_num(reg);
-        out += " 03 ";
-        out += write_hex(s->offset, 4);
-        
-        location_counter +=5;
+        outfile.write(text.data(), text.size());
     }
-
-    output.push_back(out);
 }
 
+void Assembler::print_object_file(std::ofstream& outfile)
+{
+    outfile << '\n';
+    outfile << '\n';
+    outfile << "# ------------------ OBJECT FILE ------------------\n";
+    for(const Section& section : sections)
+    {
+        // section name and size, then the contents 16 bytes per line
+        outfile << "# ." << names.name(section.name) << " " << section.length() << '\n';
+        print_section(outfile, section);
+    }
+}
 
-void Assembler::print_reloc(std::ofstream& outfile)
+void Assembler::print_section(std::ofstream& outfile, const Section& section)
 {
-    std::vector<std::string> names;
-    std::vector< std::vector<int> > indexes;
-    for(int i = 0; i < relocation_table.size(); i++)
+    std::vector<char> text;
+    size_t written = 0;
+
+    // data is null for zero bytes
+    auto print = [&](const uint8_t* data, size_t size)
     {
-        RelRecord* rel = relocation_table.at(i);
-        auto iter = std::find(names.begin(), names.end(), rel->section);
-        int section_index;
-        if (iter != names.end())
-        {
-            int section_index = iter - names.begin();
-            indexes.at(section_index).push_back(i);
-        }
+        text.resize(hex_dump_size(size));
+        if(data != nullptr)
+            hex_dump(data, size, written % 16, text.data());
         else
-        {
-            // make a new relocation section
-            names.push_back(rel->section);
-            std::vector<int> vec;
-            vec.push_back(i);
-            indexes.push_back(vec);
-        }
-    }
-    
-    for(int i = 0; i < names.size(); i++)
+            hex_zeros(size, written % 16, text.data());
+        written += size;
+
+        // the last line ends even if it is short
+        if(written == section.length())
+            text.back() = '\n';
+        outfile.write(text.data(), text.size());
+    };
+
+    size_t position = 0;
+    for(const Fill& run : section.fills)
     {
-        outfile << std::endl;
-        outfile << std::endl;
-        outfile << "# ------------------ REL." << names.at(i) << " ------------------" << std::endl;
-        for(int index : indexes.at(i))
+        if(run.position > position)
+            print(section.data.data() + position, run.position - position);
+        position = run.position;
+
+        // zero runs go out a piece at a time, they never need a buffer as big as they are
+        for(size_t left = run.size; left > 0; )
         {
-            RelRecord* rel = relocation_table.at(index);
-            outfile << rel->offset << " " << rel->type << " " << rel->symbol_number << " " << std::endl;
+            size_t piece = left < ZERO_PIECE ? left : ZERO_PIECE;
+            print(nullptr, piece);
+            left -= piece;
         }
     }
-}
-
-void Assembler::print_object_file(std::ofstream& outfile)
-{
-    outfile << std::endl;
-    outfile << std::endl;
-    outfile << "# ------------------ OBJECT FILE ------------------" << std::endl;
-    for(std::string s : output)
-        outfile << s << std::endl;
+    if(position < section.data.size())
+        print(section.data.data() + position, section.data.size() - position);
 }
 
 void Assembler::print_symtab(std::ofstream& outfile){
-    outfile << "# ------------------ SYMBOL TABLE ------------------" << std::endl;
-    outfile << std::setw(15) << "LABEL" << std::setw(15) << "SECTION" << std::setw(15) << "OFFSET" << std::setw(15) << "SCOPE" << std::setw(15) << "NUMBER" << std::endl;
-    for(Symbol* sym : symbol_table)
+    outfile << "# ------------------ SYMBOL TABLE ------------------\n";
+    outfile << std::setw(15) << "LABEL" << std::setw(15) << "SECTION" << std::setw(15) << "OFFSET" << std::setw(15) << "SCOPE" << std::setw(15) << "NUMBER" << '\n';
+    for(int i = 0; i < symbol_table.size(); i++)
     {
-        outfile << std::setw(15) << sym->label << std::setw(15) << sym->section << std::setw(15) << sym->offset << std::setw(15) << sym->scope << std::setw(15) << sym->index << std::endl;
+        print_column(outfile, symbol_table.label(i));
+        print_column(outfile, symbol_table.section_name(symbol_table.section(i)));
+        outfile << std::setw(15) << symbol_table.offset(i) << std::setw(15) << symbol_table.scope(i) << std::setw(15) << i << '\n';
     }
 }
 
 void Assembler::print_data()
 {
+    auto start = std::chrono::steady_clock::now();
     std::ofstream outfile(output_file);
 
     print_symtab(outfile);
     print_reloc(outfile);
     print_object_file(outfile);
 
+    // a full disk must not leave a short object that looks finished, the cache would keep it
+    if(!(outfile << std::flush))
+        throw AssemblerError() << "ERROR writing output file: " << output_file;
     outfile.close();
+    if(outfile.fail())
+        throw AssemblerError() << "ERROR writing output file: " << output_file;
+
+    statistics.files = 1;
+    statistics.lines = lines.size();
+    statistics.symbols = symbol_table.size();
+    statistics.relocations = relocation_table.size();
+    statistics.bytes = 0;
+    for(const Section& section : sections)
+        statistics.bytes += section.length();
+    statistics.output = seconds_since(start);
 }
-
-    const std::regex Assembler::WORD_LITERAL_REGEX("^(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
-    const std::regex Assembler::WORD_SYMBOL_REGEX("^[a-zA-Z]\\w*$");
-
-    const std::regex Assembler::REGISTER_INSTRUCTION_REGEX("^r[0-5]$");
-
-    // branch and call addressing modes and formats
-    const std::regex Assembler::BRANCH_LITERAL_REGEX("^(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
-    const std::regex Assembler::BRANCH_SYMBOL_REGEX("^[a-zA-Z]\\w*$");
-    const std::regex Assembler::BRANCH_PCREL_REGEX("^%[a-zA-Z]\\w*$");
-    const std::regex Assembler::BRANCH_MEMLITERAL_REGEX("^\\*(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
-    const std::regex Assembler::BRANCH_MEMSYMBOL_REGEX("^\\*[a-zA-Z]\\w*$");
-    const std::regex Assembler::BRANCH_REGDIR_REGEX("^\\*r[0-7]$");
-    const std::regex Assembler::BRANCH_REGIND_REGEX("^\\*\\[r[0-7]\\]$");   
-    const std::regex Assembler::BRANCH_LITERALREGIND_REGEX("^\\*\\[r[0-7]\\s?\\+\\s?(([0-9]+)|(0[xX][0-9A-Fa-f]+))\\]$");   
-    const std::regex Assembler::BRANCH_SYMBOLREGIND_REGEX("^\\*\\[r[0-7]\\s?\\+\\s?[a-zA-Z]\\w*\\]$"); 
-
-    // load store addressing modes and formats
-    const std::regex Assembler::LS_LITERAL_REGEX("^\\$(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
-    const std::regex Assembler::LS_SYMBOL_REGEX("^\\$[a-zA-Z]\\w*$");
-    const std::regex Assembler::LS_MEMLITERAL_REGEX("^(([0-9]+)|(0[xX][0-9A-Fa-f]+))$");
-    const std::regex Assembler::LS_MEMSYMBOL_REGEX("^[a-zA-Z]\\w*$");
-    const std::regex Assembler::LS_PCRELSYMBOL_REGEX("^%[a-zA-Z]\\w*$");
-    const std::regex Assembler::LS_REGDIR_REGEX("^r[0-7]$");
-    const std::regex Assembler::LS_REGIND_REGEX("^\\[r[0-7]\\]$");   
-    const std::regex Assembler::LS_LITERALREGIND_REGEX("^\\[r[0-7]\\s?\\+\\s?(([0-9]+)|(0[xX][0-9A-Fa-f]+))\\]$");   
-    const std::regex Assembler::LS_SYMBOLREGIND_REGEX("^\\[r[0-7]\\s?\\+\\s?[a-zA-Z]\\w*\\]$"); 
\ No newline at end of file
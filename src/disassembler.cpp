@@ -0,0 +1,699 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <climits>
+
+#include "../inc/disassembler.h"
+#include "../inc/object_reader.h"
+
+// value of every hex digit character, -1 for the rest
+static constexpr std::array<int8_t, 256> make_hex_digits()
+{
+    std::array<int8_t, 256> digits = {};
+    for(int i = 0; i < 256; i++)
+        digits[i] = -1;
+    for(int i = 0; i < 10; i++)
+        digits['0' + i] = i;
+    for(int i = 0; i < 6; i++)
+    {
+        digits['A' + i] = 10 + i;
+        digits['a' + i] = 10 + i;
+    }
+    return digits;
+}
+
+static constexpr std::array<int8_t, 256> HEX_DIGITS = make_hex_digits();
+
+static const Instruction* const PUSH = find_instruction("push");
+static const Instruction* const POP = find_instruction("pop");
+
+Disassembler::Disassembler(const std::string& _input, const std::string& _output) : input(_input), output(_output),
+block(BLOCK_SIZE), block_start(0), block_end(0), end_of_file(false), line_number(0),
+next_unplaced(0), sections_written(false), section_size(0), section_offset(0), next_label(0),
+section_relocations(nullptr), next_relocation(0), span_start(0), zeros_before(0)
+{
+}
+
+void Disassembler::disassemble()
+{
+    auto start = std::chrono::steady_clock::now();
+    in.open(input, std::ios::binary);
+    if(!in)
+        throw AssemblerError() << "ERROR opening input file: " << input;
+    out.open(output);
+    if(!out)
+        throw AssemblerError() << "ERROR opening output file: " << output;
+
+    read_tables();
+    statistics.read = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    read_sections();
+    // flush only checks the write into the buffer, the rest of it goes out here
+    if(!(out << std::flush))
+        throw AssemblerError() << "ERROR writing output file: " << output;
+    out.close();
+    if(out.fail())
+        throw AssemblerError() << "ERROR writing output file: " << output;
+    statistics.output = seconds_since(start);
+
+    statistics.files = 1;
+    statistics.lines = line_number;
+    statistics.symbols = symbols.size();
+}
+
+Disassembler::Decoded Disassembler::decode(const uint8_t* bytes, size_t available)
+{
+    Decoded d = {nullptr, 0, 0, 0, 0, 0};
+    const Instruction* instruction = find_opcode(bytes[0]);
+    if(instruction == nullptr)
+        return d;
+    if(instruction->format == Format::NONE)
+    {
+        d.instruction = instruction;
+        d.size = 1;
+        return d;
+    }
+    if(available < 2)
+        return d;
+
+    // only what instruction_handler_sp writes, so the source gives the same bytes back
+    uint8_t reg_d = bytes[1] >> 4;
+    uint8_t reg_s = bytes[1] & 0xF;
+    uint8_t size = 0;
+    switch(instruction->format)
+    {
+    case Format::INT:
+        if(reg_d <= 5 && reg_s == 0xF)
+            size = 2;
+        break;
+    case Format::REG:
+        if(reg_d <= 5 && reg_s == 0)
+            size = 2;
+        break;
+    case Format::REG_PAIR:
+        if(reg_d <= 5 && reg_s <= 5)
+            size = 2;
+        break;
+    case Format::BRANCH:
+    case Format::DATA:
+    {
+        if(available < 3)
+            return d;
+        uint8_t mode = bytes[2];
+        bool branch = instruction->format == Format::BRANCH;
+
+        // push and pop are a store and a load through r6 that update it
+        if(instruction->opcode == STORE_OPCODE && mode == 0x22 && reg_d == 6 && reg_s <= 5)
+        {
+            instruction = PUSH;
+            size = 3;
+            break;
+        }
+        if(instruction->opcode == LOAD_OPCODE && mode == 0x32 && reg_s == 6 && reg_d <= 5)
+        {
+            instruction = POP;
+            size = 3;
+            break;
+        }
+
+        // branches have no destination register, it is always F
+        if(branch ? reg_d != 0xF : reg_d > 7)
+            return d;
+        switch(mode)
+        {
+        // immediate, str has none
+        case 0x00:
+            if(reg_s == 0 && (branch || instruction->opcode == LOAD_OPCODE))
+                size = 5;
+            break;
+        case 0x01:
+        case 0x02:
+            if(reg_s <= 7)
+                size = 3;
+            break;
+        case 0x03:
+            if(reg_s <= 7)
+                size = 5;
+            break;
+        case 0x04:
+            if(reg_s == 0)
+                size = 5;
+            break;
+        // pc relative branch
+        case 0x05:
+            if(branch && reg_s == 7)
+                size = 5;
+            break;
+        }
+        if(size == 5 && available < 5)
+            return d;
+        d.mode = mode;
+        if(size == 5)
+            d.word = bytes[3] << 8 | bytes[4];
+        break;
+    }
+    default:
+        break;
+    }
+
+    if(size != 0)
+    {
+        d.instruction = instruction;
+        d.size = size;
+        d.reg_d = reg_d;
+        d.reg_s = reg_s;
+    }
+    return d;
+}
+
+bool Disassembler::next_line(std::string_view& line)
+{
+    while(true)
+    {
+        const char* begin = block.data() + block_start;
+        const char* newline = (const char*)memchr(begin, '\n', block_end - block_start);
+        if(newline != nullptr)
+        {
+            line = std::string_view(begin, newline - begin);
+            block_start = newline - block.data() + 1;
+            line_number++;
+            return true;
+        }
+        if(end_of_file)
+        {
+            if(block_start == block_end)
+                return false;
+            line = std::string_view(begin, block_end - block_start);
+            block_start = block_end;
+            line_number++;
+            return true;
+        }
+
+        // the start of a line moves to the front of the block, the rest is read after it
+        size_t left = block_end - block_start;
+        memmove(block.data(), begin, left);
+        if(left == block.size())
+            block.resize(2 * block.size());
+        in.read(block.data() + left, block.size() - left);
+        if(in.bad())
+            throw AssemblerError() << "ERROR reading input file: " << input;
+        block_start = 0;
+        block_end = left + in.gcount();
+        end_of_file = !in;
+    }
+}
+
+AssemblerError Disassembler::invalid_line(std::string_view line) const
+{
+    return AssemblerError() << "ERROR reading object file " << input << ", line " << line_number << " is not valid: " << line;
+}
+
+void Disassembler::read_tables()
+{
+    ObjectBlock table = ObjectBlock::NONE;
+    std::vector<ObjectRelocation>* section = nullptr;
+    std::string section_name;
+    std::vector<std::string_view> tokens;
+    uint64_t relocation_count = 0;
+
+    std::string_view line;
+    bool data_found = false;
+    while(!data_found && next_line(line))
+    {
+        if(is_block_header(line))
+        {
+            table = block_header(line, section_name);
+            if(table == ObjectBlock::NONE)
+                throw invalid_line(line);
+            if(table == ObjectBlock::RELOCATIONS)
+                section = &relocations[section_name];
+            data_found = table == ObjectBlock::DATA;
+            continue;
+        }
+
+        tokens.clear();
+        split_columns(line, tokens);
+        if(tokens.empty())
+            continue;
+
+        if(table == ObjectBlock::SYMBOLS)
+        {
+            if(is_symbol_title(tokens))
+                continue;
+
+            ObjectSymbol symbol;
+            if(!symbol_row(tokens, symbols.size(), symbol))
+                throw invalid_line(line);
+            symbols.push_back(symbol);
+        }
+        else if(table == ObjectBlock::RELOCATIONS)
+        {
+            ObjectRelocation relocation;
+            if(!relocation_row(tokens, relocation))
+                throw invalid_line(line);
+            if(relocation.symbol < 0 || relocation.symbol >= (int32_t)symbols.size())
+                throw AssemblerError() << "ERROR reading object file " << input << ", line " << line_number << " uses symbol "
+                                       << relocation.symbol << " that does not exist";
+            section->push_back(relocation);
+            relocation_count++;
+        }
+        else
+            throw invalid_line(line);
+    }
+    if(!data_found)
+        throw AssemblerError() << "ERROR reading object file " << input << ", it has no OBJECT FILE part";
+    statistics.relocations = relocation_count;
+
+    // the assembler sorts them already
+    for(auto& entry : relocations)
+    {
+        std::stable_sort(entry.second.begin(), entry.second.end(),
+            [](const ObjectRelocation& a, const ObjectRelocation& b) { return a.offset < b.offset; });
+    }
+
+    // extern and equ symbols are not in a section, they are written once the symbols before them are
+    for(size_t i = 0; i < symbols.size(); i++)
+    {
+        if(symbols[i].section != "UND" && symbols[i].section != "ABS")
+            continue;
+        unplaced.push_back(i);
+        if(symbols[i].section == "ABS")
+            equ_values.emplace((uint16_t)symbols[i].offset, i);
+    }
+
+    text += "# " + input + " disassembled\n";
+    for(const ObjectSymbol& symbol : symbols)
+    {
+        if(symbol.scope == 'g' && symbol.section != "UND")
+            text += ".global " + symbol.label + "\n";
+    }
+}
+
+void Disassembler::read_sections()
+{
+    std::string_view line;
+    while(next_line(line))
+    {
+        if(is_section_header(line))
+        {
+            std::string name;
+            uint32_t size;
+            if(!section_header(line, name, size))
+                throw invalid_line(line);
+
+            if(!section.empty())
+                finish_section();
+            start_section(name, size);
+            continue;
+        }
+        if(section.empty() && line.find_first_not_of(" \t\r") != std::string_view::npos)
+            throw invalid_line(line);
+
+        add_bytes(line);
+    }
+    if(!section.empty())
+        finish_section();
+
+    for(const auto& entry : relocations)
+    {
+        if(!entry.second.empty())
+            throw AssemblerError() << "ERROR reading object file " << input << ", relocations for section " << entry.first
+                                   << " that it does not have";
+    }
+
+    print_symbols_before(INT_MAX);
+    text += ".end\n";
+    flush(true);
+}
+
+void Disassembler::start_section(const std::string& name, uint32_t size)
+{
+    section = name;
+    section_size = size;
+    section_offset = 0;
+
+    static const std::vector<ObjectRelocation> none;
+    auto found = relocations.find(name);
+    section_relocations = found == relocations.end() ? &none : &found->second;
+    next_relocation = 0;
+
+    // the section symbol comes from .section itself, the other symbols of the section are labels
+    int number = INT_MAX;
+    labels.clear();
+    for(size_t i = 0; i < symbols.size(); i++)
+    {
+        if(symbols[i].section != name)
+            continue;
+        if(symbols[i].label == name && symbols[i].offset == 0)
+            number = std::min(number, (int)i);
+        else if(symbols[i].offset < 0 || (uint32_t)symbols[i].offset > size)
+            throw AssemblerError() << "ERROR reading object file " << input << ", symbol " << symbols[i].label
+                                   << " is outside of section " << name;
+        else
+            labels.push_back(std::make_pair(symbols[i].offset, i));
+    }
+    std::sort(labels.begin(), labels.end());
+    next_label = 0;
+
+    // code before the first .section is in BLANK, the first section, it has no section symbol
+    if(number != INT_MAX)
+        print_symbols_before(number);
+    if(number != INT_MAX || name != "BLANK" || sections_written)
+        text += "\n.section " + name + "\n";
+    sections_written = true;
+
+    span.clear();
+    span_start = 0;
+    print_labels(0);
+}
+
+void Disassembler::add_bytes(std::string_view line)
+{
+    uint32_t boundary = next_label < labels.size() ? labels[next_label].first : section_size;
+    for(size_t i = 0; i < line.size(); )
+    {
+        char c = line[i];
+        if(c == ' ' || c == '\t' || c == '\r')
+        {
+            i++;
+            continue;
+        }
+
+        // two hex digits and a separator or the end of the line
+        int high = HEX_DIGITS[(uint8_t)c];
+        int low = i + 1 < line.size() ? HEX_DIGITS[(uint8_t)line[i + 1]] : -1;
+        if(high < 0 || low < 0 || (i + 2 < line.size() && line[i + 2] != ' ' && line[i + 2] != '\t' && line[i + 2] != '\r'))
+            throw invalid_line(line);
+        i += 2;
+
+        if(section_offset == section_size)
+            throw AssemblerError() << "ERROR reading object file " << input << ", section " << section << " has more than "
+                                   << section_size << " bytes";
+        span.push_back(high << 4 | low);
+        section_offset++;
+
+        if(section_offset == boundary && boundary != section_size)
+        {
+            finish_span(true);
+            print_labels(section_offset);
+            boundary = next_label < labels.size() ? labels[next_label].first : section_size;
+        }
+    }
+
+    if(span.size() > SPAN_LIMIT)
+        finish_span(false);
+    flush();
+}
+
+void Disassembler::finish_section()
+{
+    if(section_offset != section_size)
+        throw AssemblerError() << "ERROR reading object file " << input << ", section " << section << " has "
+                               << section_offset << " bytes instead of " << section_size;
+
+    finish_span(true);
+    print_labels(section_offset);
+    if(next_relocation != section_relocations->size())
+        throw AssemblerError() << "ERROR reading object file " << input << ", relocation at " << (*section_relocations)[next_relocation].offset
+                               << " is outside of section " << section;
+
+    relocations.erase(section);
+    section_relocations = nullptr;
+    section.clear();
+}
+
+void Disassembler::finish_span(bool at_label)
+{
+    size_t n = span.size();
+    if(n == 0)
+        return;
+    // without a label the last bytes are kept back, they may be part of the next instruction
+    size_t end = at_label ? n : n - SPAN_KEPT;
+
+    span_relocations.assign(n, -1);
+    size_t relocation = next_relocation;
+    for(; relocation < section_relocations->size() && (*section_relocations)[relocation].offset < span_start + n; relocation++)
+    {
+        uint32_t offset = (*section_relocations)[relocation].offset - span_start;
+        if(span_relocations[offset] != -1)
+            throw AssemblerError() << "ERROR reading object file " << input << ", two relocations at offset "
+                                   << span_start + offset << " of section " << section;
+        span_relocations[offset] = relocation;
+    }
+
+    // the bytes could also have been written some other way, any way that covers the whole
+    // span is right; from the end back, find the piece to start with at every byte so the rest
+    // still fits, instructions before .word
+    pieces.assign(n + 1, NO_PIECE);
+    for(size_t i = end; i <= n; i++)
+        pieces[i] = END;
+    for(size_t i = end; i-- > 0; )
+    {
+        if(span[i] == 0 && span_relocations[i] == -1 && pieces[i + 1] != NO_PIECE)
+        {
+            pieces[i] = ZERO;
+            continue;
+        }
+        Decoded d = decode(&span[i], n - i);
+        if(d.size != 0 && pieces[i + d.size] != NO_PIECE && fits(d, i))
+            pieces[i] = INSTRUCTION;
+        else if(i + 2 <= n && pieces[i + 2] != NO_PIECE && fits_word(i))
+            pieces[i] = WORD;
+    }
+    if(pieces[0] == NO_PIECE)
+        throw AssemblerError() << "ERROR disassembling " << input << ", the bytes of section " << section << " from offset "
+                               << span_start << " can not be written as instructions, .word and .skip";
+
+    // then from the front, a zero run is a .skip
+    size_t i = 0;
+    while(i < end)
+    {
+        if(zeros_before != 0 && pieces[i] != ZERO)
+        {
+            print_zeros(zeros_before);
+            zeros_before = 0;
+        }
+
+        switch(pieces[i])
+        {
+        case ZERO:
+        {
+            size_t zeros = i + 1;
+            while(zeros < end && pieces[zeros] == ZERO)
+                zeros++;
+            zeros_before += zeros - i;
+            i = zeros;
+            // a run up to where a part of a long span ends may go on in the next part
+            if(i < end || at_label)
+            {
+                print_zeros(zeros_before);
+                zeros_before = 0;
+            }
+            break;
+        }
+        case INSTRUCTION:
+        {
+            Decoded d = decode(&span[i], n - i);
+            print(d, i);
+            i += d.size;
+            break;
+        }
+        default:
+            text += "    .word ";
+            if(span_relocations[i] != -1)
+                text += symbols[(*section_relocations)[span_relocations[i]].symbol].label;
+            else
+                print_word(span[i] << 8 | span[i + 1]);
+            text += '\n';
+            i += 2;
+            break;
+        }
+    }
+
+    statistics.bytes += i;
+    span.erase(span.begin(), span.begin() + i);
+    span_start += i;
+    while(next_relocation < section_relocations->size() && (*section_relocations)[next_relocation].offset < span_start)
+        next_relocation++;
+}
+
+bool Disassembler::fits(const Decoded& d, size_t at) const
+{
+    bool branch = d.instruction->format == Format::BRANCH;
+    int relocation = -1;
+    for(size_t i = 0; i < d.size; i++)
+    {
+        if(span_relocations[at + i] == -1)
+            continue;
+        // only the 16 bit operand is relocated
+        if(i != 3)
+            return false;
+        relocation = span_relocations[at + i];
+    }
+
+    if(relocation == -1)
+    {
+        // a pc relative branch always names a symbol, one without a relocation was an equ symbol
+        return d.mode != 0x05 || equ_values.count(d.word) != 0;
+    }
+
+    // the encoder writes the offset of the symbol, the linker adds the rest
+    const ObjectRelocation& r = (*section_relocations)[relocation];
+    if((uint16_t)symbols[r.symbol].offset != d.word)
+        return false;
+    if(r.type == RelocationType::PCREL_16)
+        return d.mode == 0x05 || (!branch && d.mode == 0x03 && d.reg_s == 7);
+    return d.mode != 0x05;
+}
+
+bool Disassembler::fits_word(size_t at) const
+{
+    if(span_relocations[at + 1] != -1)
+        return false;
+    if(span_relocations[at] == -1)
+        return true;
+
+    const ObjectRelocation& r = (*section_relocations)[span_relocations[at]];
+    return r.type == RelocationType::ABSOLUTE_16 && (uint16_t)symbols[r.symbol].offset == (span[at] << 8 | span[at + 1]);
+}
+
+void Disassembler::print_symbols_before(int number)
+{
+    for(; next_unplaced < unplaced.size() && unplaced[next_unplaced] < number; next_unplaced++)
+    {
+        const ObjectSymbol& symbol = symbols[unplaced[next_unplaced]];
+        if(symbol.section == "UND")
+            text += ".extern " + symbol.label + "\n";
+        else
+            text += ".equ " + symbol.label + ", " + std::to_string((uint32_t)symbol.offset) + "\n";
+    }
+}
+
+void Disassembler::print_labels(uint32_t offset)
+{
+    for(; next_label < labels.size() && labels[next_label].first == offset; next_label++)
+    {
+        print_symbols_before(labels[next_label].second);
+        text += symbols[labels[next_label].second].label + ":\n";
+    }
+}
+
+void Disassembler::print(const Decoded& d, size_t at)
+{
+    text += "    ";
+    text += d.instruction->mnemonic;
+    switch(d.instruction->format)
+    {
+    case Format::NONE:
+        break;
+    case Format::INT:
+    case Format::REG:
+        text += " r";
+        text += '0' + d.reg_d;
+        break;
+    case Format::REG_PAIR:
+        text += " r";
+        text += '0' + d.reg_d;
+        text += ", r";
+        text += '0' + d.reg_s;
+        break;
+    case Format::STACK:
+        text += " r";
+        text += '0' + (d.instruction == PUSH ? d.reg_s : d.reg_d);
+        break;
+    case Format::BRANCH:
+        text += ' ';
+        print_operand(d, at);
+        break;
+    case Format::DATA:
+        text += " r";
+        text += '0' + d.reg_d;
+        text += ", ";
+        print_operand(d, at);
+        break;
+    }
+    text += '\n';
+}
+
+void Disassembler::print_operand(const Decoded& d, size_t at)
+{
+    // the same syntax the lexer reads, see OperandMode
+    bool branch = d.instruction->format == Format::BRANCH;
+    int relocation = d.size == 5 ? span_relocations[at + 3] : -1;
+    auto value = [&]()
+    {
+        if(relocation != -1)
+            text += symbols[(*section_relocations)[relocation].symbol].label;
+        else
+            print_word(d.word);
+    };
+    const char reg[] = {'r', (char)('0' + d.reg_s), '\0'};
+
+    switch(d.mode)
+    {
+    case 0x00:
+        text += branch ? "" : "$";
+        value();
+        break;
+    case 0x01:
+        text += branch ? "*" : "";
+        text += reg;
+        break;
+    case 0x02:
+        text += branch ? "*[" : "[";
+        text += reg;
+        text += ']';
+        break;
+    case 0x03:
+        if(relocation != -1 && (*section_relocations)[relocation].type == RelocationType::PCREL_16)
+        {
+            text += '%';
+            value();
+            break;
+        }
+        text += branch ? "*[" : "[";
+        text += reg;
+        text += " + ";
+        value();
+        text += ']';
+        break;
+    case 0x04:
+        text += branch ? "*" : "";
+        value();
+        break;
+    case 0x05:
+        text += '%';
+        if(relocation != -1)
+            value();
+        else
+            text += symbols[equ_values.at(d.word)].label;
+        break;
+    }
+}
+
+void Disassembler::print_zeros(uint64_t count)
+{
+    if(count == 1)
+        text += "    halt\n";
+    else
+        text += "    .skip " + std::to_string(count) + "\n";
+}
+
+void Disassembler::print_word(uint16_t word)
+{
+    const char digits[] = "0123456789ABCDEF";
+    text += "0x";
+    for(int shift = 12; shift >= 0; shift -= 4)
+        text += digits[(word >> shift) & 0xF];
+}
+
+void Disassembler::flush(bool force)
+{
+    if(text.size() < BLOCK_SIZE && !force)
+        return;
+    out.write(text.data(), text.size());
+    text.clear();
+    if(!out)
+        throw AssemblerError() << "ERROR writing output file: " << output;
+}
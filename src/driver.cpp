@@ -0,0 +1,289 @@
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+#include "../inc/driver.h"
+#include "../inc/parser.h"
+#include "../inc/assembler.h"
+#include "../inc/object_cache.h"
+#include "../inc/disassembler.h"
+
+// a path given by the user, relative to the directory the run was started in
+static std::string resolve(const Options& options, const std::string& path)
+{
+    if(options.directory.empty() || path == "-")
+        return path;
+    return (std::filesystem::path(options.directory) / path).string();
+}
+
+// make rule for an object: it depends on its input and on everything the input includes,
+// every include also gets an empty rule, so make does not fail once it is deleted
+static void write_dependencies(const Options& options, const std::string& input, const std::string& output, const Assembler& as)
+{
+    // spaces are escaped the way make reads them
+    auto escape = [](const std::string& path)
+    {
+        std::string escaped;
+        for(char c : path)
+        {
+            if(c == ' ')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    };
+    // includes are found from the resolved input, the rule names them like the user did
+    auto given = [&](const std::string& path)
+    {
+        std::string prefix = options.directory + "/";
+        if(!options.directory.empty() && path.compare(0, prefix.size(), prefix) == 0)
+            return path.substr(prefix.size());
+        return path;
+    };
+
+    std::string rules = escape(output) + ":";
+    if(input != "-")
+        rules += " " + escape(input);
+    for(const auto& include : as.includes())
+        rules += " " + escape(given(include->path));
+    rules += "\n";
+    for(const auto& include : as.includes())
+        rules += "\n" + escape(given(include->path)) + ":\n";
+
+    std::string filename = std::filesystem::path(resolve(options, output)).replace_extension(".d").string();
+    std::ofstream file(filename);
+    if(!(file << rules << std::flush))
+        throw AssemblerError() << "ERROR writing dependency file: " << filename;
+}
+
+// assemble one input into one object file, or copy it from the cache
+static Stats assemble(const Options& options, const std::string& input, const std::string& output, ThreadPool* pool,
+    const ObjectCache* cache)
+{
+    Parser parser(resolve(options, input));
+    if(input == "-" && options.has_source)
+        parser.use_text(options.source);
+    Assembler as(&parser, resolve(options, output));
+
+    try
+    {
+        // the peephole stage changes the code, so it is part of the key;
+        // -j and --one-pass are not, the output does not depend on them
+        std::string key;
+        if(cache != nullptr)
+        {
+            std::vector<std::string_view> includes;
+            for(const auto& include : as.includes())
+                includes.push_back(include->text);
+
+            key = cache->key(parser.text(), includes, options.peephole ? "--peephole" : "");
+            if(cache->fetch(key, resolve(options, output)))
+            {
+                if(options.dependencies)
+                    write_dependencies(options, input, output, as);
+
+                Stats stats = as.stats();
+                stats.files = 1;
+                stats.cached = 1;
+                return stats;
+            }
+        }
+
+        if(pool != nullptr)
+            as.set_thread_pool(pool);
+        else
+            as.set_threads(options.threads);
+
+        if(options.one_pass)
+        {
+            as.one_pass();
+        }
+        else
+        {
+            as.first_pass();
+            if(options.peephole)
+                as.optimize();
+            as.second_pass();
+        }
+
+        // the passes throw if the object could not be written, only a complete one is stored
+        if(cache != nullptr)
+            cache->store(key, resolve(options, output));
+        if(options.dependencies)
+            write_dependencies(options, input, output, as);
+        return as.stats();
+    }
+    catch(const AssemblerError& e)
+    {
+        throw as.located(e);
+    }
+}
+
+// write an object file back as source, see disassembler.h
+static Stats disassemble(const Options& options, const std::string& input, const std::string& output)
+{
+    Disassembler disassembler(resolve(options, input), resolve(options, output));
+    disassembler.disassemble();
+    return disassembler.stats();
+}
+
+bool parse_options(const std::vector<std::string>& args, Options& options, std::ostream& out)
+{
+    for(size_t i = 0; i < args.size(); i++)
+    {
+        const std::string& arg = args.at(i);
+        if(arg == "-o" && i + 1 < args.size())
+            options.output = args.at(++i);
+        else if(arg == "-j" && i + 1 < args.size())
+            options.threads = atoi(args.at(++i).c_str());
+        else if(arg == "--cache-dir" && i + 1 < args.size())
+            options.cache_dir = args.at(++i);
+        else if(arg == "--serve" && i + 1 < args.size())
+            options.serve = args.at(++i);
+        else if(arg == "--server" && i + 1 < args.size())
+            options.server = args.at(++i);
+        else if(arg == "--stop")
+            options.stop = true;
+        else if(arg == "--one-pass")
+            options.one_pass = true;
+        else if(arg == "--peephole")
+            options.peephole = true;
+        else if(arg == "-MD")
+            options.dependencies = true;
+        else if(arg == "-d")
+            options.disassemble = true;
+        else if(arg == "--stats" || arg == "--stats=json")
+        {
+            options.stats = true;
+            options.stats_json = arg == "--stats=json";
+        }
+        else if(arg.size() > 1 && arg.at(0) == '@')
+        {
+            if(!read_response_file(resolve(options, arg.substr(1)), options.inputs))
+            {
+                out << "ERROR starting, cannot read response file " << arg.substr(1) << std::endl;
+                return false;
+            }
+        }
+        else
+            options.inputs.push_back(arg);
+    }
+
+    if(options.threads < 0)
+        options.threads = 0;
+    return true;
+}
+
+int run(const Options& options, ThreadPool* pool, std::ostream& out, std::ostream& err)
+{
+    if(options.inputs.empty() || options.output.empty()){
+        out << "ERROR starting, usage: assembler [--one-pass | --peephole] [-MD] [-j threads] [--stats[=json]] [--cache-dir dir] [--server socket] -o output input" << std::endl;
+        out << "                       assembler [--one-pass | --peephole] [-MD] [-j threads] [--stats[=json]] [--cache-dir dir] [--server socket] -o outdir/ input... [@response_file]" << std::endl;
+        out << "                       assembler -d [-j threads] [--stats[=json]] -o output input.o" << std::endl;
+        out << "                       assembler [-j threads] --serve socket" << std::endl;
+        out << "                       assembler --server socket --stop" << std::endl;
+        return 1;
+    }
+
+    if(options.one_pass && options.peephole)
+    {
+        out << "ERROR starting, --peephole runs between the two passes, it cannot be used with --one-pass" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<ObjectCache> cache;
+    if(!options.cache_dir.empty())
+        cache.reset(new ObjectCache(resolve(options, options.cache_dir)));
+
+    // one input and an output file name
+    std::string output = resolve(options, options.output);
+    if(options.inputs.size() == 1 && output.back() != '/' && !std::filesystem::is_directory(output))
+    {
+        Stats totals;
+        try
+        {
+            if(options.disassemble)
+                totals = disassemble(options, options.inputs.at(0), options.output);
+            else
+                totals = assemble(options, options.inputs.at(0), options.output, pool, cache.get());
+        }
+        catch(const AssemblerError& e)
+        {
+            out << e.what() << std::endl;
+            return 1;
+        }
+
+        if(options.stats)
+            print_stats(err, totals, options.stats_json);
+        return 0;
+    }
+
+    // batch, every input becomes outdir/name.o, or outdir/name.s with -d
+    std::filesystem::path outdir(options.output);
+    std::vector<std::string> outputs;
+    std::set<std::string> used;
+    for(const std::string& input : options.inputs)
+    {
+        outputs.push_back((outdir / std::filesystem::path(input).stem()).string() + (options.disassemble ? ".s" : ".o"));
+        if(!used.insert(outputs.back()).second)
+        {
+            out << "ERROR starting, two inputs would write " << outputs.back() << std::endl;
+            return 1;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(output, ec);
+    if(!std::filesystem::is_directory(output))
+    {
+        out << "ERROR starting, cannot create output directory " << options.output << std::endl;
+        return 1;
+    }
+
+    // files are assembled on the same pool their passes split their work on,
+    // an error only stops its own file
+    std::unique_ptr<ThreadPool> own_pool;
+    if(pool == nullptr)
+    {
+        own_pool.reset(new ThreadPool(options.threads));
+        pool = own_pool.get();
+    }
+
+    std::vector<std::string> errors(options.inputs.size());
+    std::vector<Stats> file_stats(options.inputs.size());
+    pool->parallel_for(options.inputs.size(), [&](size_t i)
+    {
+        try
+        {
+            if(options.disassemble)
+                file_stats.at(i) = disassemble(options, options.inputs.at(i), outputs.at(i));
+            else
+                file_stats.at(i) = assemble(options, options.inputs.at(i), outputs.at(i), pool, cache.get());
+        }
+        catch(const AssemblerError& e)
+        {
+            errors.at(i) = e.what();
+        }
+        catch(const std::exception& e)
+        {
+            errors.at(i) = std::string("ERROR ") + e.what();
+        }
+    });
+
+    int status = 0;
+    Stats totals; // of the files that were assembled, times are summed
+    for(size_t i = 0; i < options.inputs.size(); i++)
+    {
+        if(!errors.at(i).empty())
+        {
+            out << options.inputs.at(i) << ": " << errors.at(i) << std::endl;
+            status = 1;
+        }
+        totals.add(file_stats.at(i));
+    }
+
+    if(options.stats)
+        print_stats(err, totals, options.stats_json);
+
+    return status;
+}
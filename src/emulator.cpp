@@ -0,0 +1,532 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <bitset>
+#include <memory>
+
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../inc/emulator.h"
+#include "../inc/jit.h"
+
+// the terminal settings to restore, one emulated terminal per process
+static struct termios saved_terminal;
+
+Emulator::Emulator() : memory(MEMORY_SIZE, 0), decoded(MEMORY_SIZE, Decoded{UNDECODED, 0, 0, 0, 0, 0}), psw(0),
+instruction_count(0), halt_reached(false), jit(nullptr), terminal_started(false), input_open(true), terminal_pending(false)
+{
+    for(uint16_t& reg : regs)
+        reg = 0;
+}
+
+void Emulator::load_hex(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if(!file)
+        throw AssemblerError() << "ERROR opening input file: " << filename;
+
+    std::string line;
+    for(size_t number = 1; std::getline(file, line); number++)
+    {
+        if(line.empty())
+            continue;
+
+        // "addr: b0 b1 ... b7", every field in hex
+        std::istringstream fields(line);
+        unsigned address, byte;
+        char colon;
+        if(!(fields >> std::hex >> address >> colon) || colon != ':' || address >= MEMORY_SIZE)
+            throw AssemblerError() << "ERROR reading " << filename << ", line " << number << " is not valid: " << line;
+
+        while(fields >> std::hex >> byte)
+        {
+            if(byte > 0xFF || address >= MEMORY_SIZE)
+                throw AssemblerError() << "ERROR reading " << filename << ", line " << number << " is not valid: " << line;
+            memory[address++] = byte;
+        }
+        if(!fields.eof())
+            throw AssemblerError() << "ERROR reading " << filename << ", line " << number << " is not valid: " << line;
+    }
+}
+
+void Emulator::load_image(const std::vector<uint8_t>& image)
+{
+    if(image.size() > MEMORY_SIZE)
+        throw AssemblerError() << "ERROR loading, the image is larger than the memory";
+    std::copy(image.begin(), image.end(), memory.begin());
+    std::fill(decoded.begin(), decoded.end(), Decoded{UNDECODED, 0, 0, 0, 0, 0});
+}
+
+Emulator::Decoded Emulator::decode(uint16_t address) const
+{
+    Decoded d{INVALID, 1, 0, 0, 0, 0};
+    uint8_t opcode = memory[address];
+    uint8_t registers = memory[(uint16_t)(address + 1)];
+    uint8_t mode = memory[(uint16_t)(address + 2)];
+    uint8_t reg_d = registers >> 4;
+    uint8_t reg_s = registers & 0xF;
+
+    // one byte, no registers
+    switch(opcode)
+    {
+    case 0x00: d.op = HALT; return d;
+    case 0x20: d.op = IRET; return d;
+    case 0x40: d.op = RET; return d;
+    default: break;
+    }
+
+    // two bytes, regD and regS
+    static const Op TWO_BYTE[16][8] = {
+        {}, {INT}, {}, {}, {}, {}, {XCHG}, {ADD, SUB, MUL, DIV, CMP},
+        {NOT, AND, OR, XOR, TEST}, {SHL, SHR}, {}, {}, {}, {}, {}, {}
+    };
+    if((opcode >> 4) != 0x3 && (opcode >> 4) != 0x5 && (opcode >> 4) < 0xA && (opcode & 0xF) < 8)
+    {
+        Op op = TWO_BYTE[opcode >> 4][opcode & 0xF];
+        if(op == UNDECODED || reg_d > 7 || (op == INT ? reg_s != 0xF : reg_s > 7))
+            return d;
+        return Decoded{op, 2, reg_d, reg_s, 0, 0};
+    }
+
+    // the payload follows the addressing byte
+    uint16_t payload = read_word(address + 3);
+    uint8_t update = mode >> 4;
+    uint8_t addressing = mode & 0xF;
+    bool has_payload = addressing == 0 || addressing == 3 || addressing == 4 || addressing == 5;
+
+    // branches have no destination register, it is always F
+    if(opcode == 0x30 || (opcode >= 0x50 && opcode <= 0x53))
+    {
+        static const Op BRANCHES[] = {JMP, JEQ, JNE, JGT};
+        if(reg_d != 0xF || update != 0 || addressing > 5 || (addressing != 0 && addressing != 4 && reg_s > 7))
+            return d;
+        Op op = opcode == 0x30 ? CALL : BRANCHES[opcode & 0xF];
+        return Decoded{op, (uint8_t)(has_payload ? 5 : 3), reg_d, reg_s, addressing, payload};
+    }
+
+    if(opcode != 0xA0 && opcode != 0xB0)
+        return d;
+
+    // push and pop, the way stack_handler_sp writes them
+    if(opcode == 0xB0 && mode == 0x22 && reg_d == 6 && reg_s < 8)
+        return Decoded{PUSH, 3, reg_d, reg_s, 0, 0};
+    if(opcode == 0xA0 && mode == 0x32 && reg_s == 6 && reg_d < 8)
+        return Decoded{POP, 3, reg_d, reg_s, 0, 0};
+
+    static const Op LOADS[] = {LDR_IMM, LDR_REG, LDR_IND, LDR_DISP, LDR_MEM};
+    static const Op STORES[] = {INVALID, STR_REG, STR_IND, STR_DISP, STR_MEM};
+    if(update != 0 || addressing > 4 || reg_d > 7 || reg_s > 7)
+        return d;
+    Op op = opcode == 0xA0 ? LOADS[addressing] : STORES[addressing];
+    if(op == INVALID)
+        return d;
+    return Decoded{op, (uint8_t)(has_payload ? 5 : 3), reg_d, reg_s, addressing, payload};
+}
+
+void Emulator::write_word(uint16_t address, uint16_t value)
+{
+    memory[address] = value >> 8;
+    memory[(uint16_t)(address + 1)] = value & 0xFF;
+
+    // instructions are at most 5 bytes, any that covers the word is decoded again
+    for(int i = -4; i <= 1; i++)
+        decoded[(uint16_t)(address + i)] = Decoded{UNDECODED, 0, 0, 0, 0, 0};
+    if(jit != nullptr)
+        jit->written(address);
+
+    if(address == TERM_OUT)
+        std::cout.put((char)(value & 0xFF));
+}
+
+void Emulator::push(uint16_t value)
+{
+    regs[6] -= 2;
+    write_word(regs[6], value);
+}
+
+uint16_t Emulator::pop()
+{
+    uint16_t value = read_word(regs[6]);
+    regs[6] += 2;
+    return value;
+}
+
+uint16_t Emulator::branch_target(const Decoded& d) const
+{
+    switch(d.mode)
+    {
+    case 0: return d.payload; // immediate
+    case 1: return regs[d.reg_s]; // register
+    case 2: return read_word(regs[d.reg_s]); // memory at register
+    case 3: return read_word(regs[d.reg_s] + d.payload); // memory at register + displacement
+    case 4: return read_word(d.payload); // memory
+    default: return regs[d.reg_s] + d.payload; // register + displacement, pc relative with r7
+    }
+}
+
+void Emulator::interrupt(int vector)
+{
+    push(regs[7]);
+    push(psw);
+    psw |= PSW_I;
+    regs[7] = read_word(vector * 2);
+}
+
+void Emulator::run(uint64_t max_instructions, bool devices, bool translate)
+{
+    // threaded dispatch: every handler jumps straight to the handler of the next instruction
+    static void* const HANDLERS[OP_COUNT] = {
+        &&op_undecoded, &&op_invalid,
+        &&op_halt, &&op_int, &&op_iret, &&op_call, &&op_ret, &&op_jmp, &&op_jeq, &&op_jne, &&op_jgt,
+        &&op_xchg, &&op_add, &&op_sub, &&op_mul, &&op_div, &&op_cmp, &&op_not, &&op_and, &&op_or, &&op_xor, &&op_test, &&op_shl, &&op_shr,
+        &&op_ldr_imm, &&op_ldr_reg, &&op_ldr_ind, &&op_ldr_disp, &&op_ldr_mem,
+        &&op_str_reg, &&op_str_ind, &&op_str_disp, &&op_str_mem,
+        &&op_push, &&op_pop
+    };
+
+    // reset
+    for(uint16_t& reg : regs)
+        reg = 0;
+    regs[6] = STACK_START;
+    regs[7] = read_word(RESET * 2);
+    psw = 0;
+    instruction_count = 0;
+    halt_reached = false;
+
+    // the translated code lives as long as the run
+    std::unique_ptr<Jit> translator(translate ? new Jit(*this) : nullptr);
+    jit = translator.get();
+
+    if(devices)
+        start_terminal();
+    // the first tick is a whole period away, tim_cfg is 0 after reset
+    next_tick = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+
+    uint16_t* r = regs;
+    Decoded* d = nullptr;
+    uint32_t slice = 0; // instructions of this turn between two polls
+    uint32_t budget = 0; // of them still to run
+
+// budget is taken before an instruction runs, so slice - budget have run
+#define NEXT() \
+    do { \
+        if(budget == 0) \
+            goto poll; \
+        if(translate) \
+            goto translated; \
+        budget--; \
+        d = &decoded[r[7]]; \
+        r[7] += d->size; \
+        goto *HANDLERS[d->op]; \
+    } while(0)
+
+poll:
+    instruction_count += slice - budget;
+    if(max_instructions != 0 && instruction_count >= max_instructions)
+        goto stop;
+    if(devices)
+        poll_devices();
+    slice = POLL_INSTRUCTIONS;
+    if(max_instructions != 0 && max_instructions - instruction_count < slice)
+        slice = max_instructions - instruction_count;
+    budget = slice;
+    NEXT();
+
+translated:
+    // blocks run until the budget is gone or an instruction is left to the interpreter, it runs one
+    budget = jit->run(budget);
+    if(budget == 0)
+        goto poll;
+    budget--;
+    d = &decoded[r[7]];
+    r[7] += d->size;
+    goto *HANDLERS[d->op];
+
+op_undecoded:
+    // the pc did not move, the size of an undecoded entry is 0
+    *d = decode(r[7]);
+    if(jit != nullptr)
+        jit->mark(r[7], d->size);
+    r[7] += d->size;
+    goto *HANDLERS[d->op];
+
+op_invalid:
+    interrupt(ERROR);
+    NEXT();
+
+op_halt:
+    instruction_count += slice - budget;
+    halt_reached = true;
+    goto stop;
+
+op_int:
+    // the vector is in the register, it is read before the pushes may overwrite the instruction
+    interrupt(r[d->reg_d] % 8);
+    NEXT();
+
+op_iret:
+    psw = pop();
+    r[7] = pop();
+    NEXT();
+
+op_call:
+{
+    uint16_t target = branch_target(*d);
+    push(r[7]);
+    r[7] = target;
+    NEXT();
+}
+
+op_ret:
+    r[7] = pop();
+    NEXT();
+
+op_jmp:
+    r[7] = branch_target(*d);
+    NEXT();
+
+op_jeq:
+    if(psw & PSW_Z)
+        r[7] = branch_target(*d);
+    NEXT();
+
+op_jne:
+    if(!(psw & PSW_Z))
+        r[7] = branch_target(*d);
+    NEXT();
+
+op_jgt:
+    // signed greater: not equal and no sign flip
+    if(!(psw & PSW_Z) && !(psw & PSW_N) == !(psw & PSW_O))
+        r[7] = branch_target(*d);
+    NEXT();
+
+op_xchg:
+{
+    uint16_t temp = r[d->reg_d];
+    r[d->reg_d] = r[d->reg_s];
+    r[d->reg_s] = temp;
+    NEXT();
+}
+
+op_add:
+    r[d->reg_d] += r[d->reg_s];
+    NEXT();
+
+op_sub:
+    r[d->reg_d] -= r[d->reg_s];
+    NEXT();
+
+op_mul:
+    r[d->reg_d] *= r[d->reg_s];
+    NEXT();
+
+op_div:
+    if(r[d->reg_s] == 0)
+    {
+        interrupt(ERROR);
+        NEXT();
+    }
+    r[d->reg_d] = (int16_t)r[d->reg_d] / (int16_t)r[d->reg_s];
+    NEXT();
+
+op_cmp:
+{
+    uint16_t a = r[d->reg_d], b = r[d->reg_s];
+    uint16_t result = a - b;
+    psw &= ~(PSW_Z | PSW_O | PSW_C | PSW_N);
+    if(result == 0)
+        psw |= PSW_Z;
+    if(result & 0x8000)
+        psw |= PSW_N;
+    if(a < b)
+        psw |= PSW_C;
+    if(((a ^ b) & (a ^ result)) & 0x8000)
+        psw |= PSW_O;
+    NEXT();
+}
+
+op_not:
+    r[d->reg_d] = ~r[d->reg_d];
+    NEXT();
+
+op_and:
+    r[d->reg_d] &= r[d->reg_s];
+    NEXT();
+
+op_or:
+    r[d->reg_d] |= r[d->reg_s];
+    NEXT();
+
+op_xor:
+    r[d->reg_d] ^= r[d->reg_s];
+    NEXT();
+
+op_test:
+{
+    uint16_t result = r[d->reg_d] & r[d->reg_s];
+    psw &= ~(PSW_Z | PSW_N);
+    if(result == 0)
+        psw |= PSW_Z;
+    if(result & 0x8000)
+        psw |= PSW_N;
+    NEXT();
+}
+
+op_shl:
+{
+    uint32_t shifted = (uint32_t)r[d->reg_d] << std::min<uint16_t>(r[d->reg_s], 17);
+    r[d->reg_d] = shifted;
+    psw &= ~(PSW_Z | PSW_C | PSW_N);
+    if((uint16_t)shifted == 0)
+        psw |= PSW_Z;
+    if(shifted & 0x10000)
+        psw |= PSW_C;
+    if(shifted & 0x8000)
+        psw |= PSW_N;
+    NEXT();
+}
+
+op_shr:
+{
+    uint16_t count = r[d->reg_s];
+    uint16_t value = r[d->reg_d];
+    bool carry = count != 0 && count <= 16 && (value >> (count - 1)) & 1;
+    value = count >= 16 ? 0 : value >> count;
+    r[d->reg_d] = value;
+    psw &= ~(PSW_Z | PSW_C | PSW_N);
+    if(value == 0)
+        psw |= PSW_Z;
+    if(carry)
+        psw |= PSW_C;
+    if(value & 0x8000)
+        psw |= PSW_N;
+    NEXT();
+}
+
+op_ldr_imm:
+    r[d->reg_d] = d->payload;
+    NEXT();
+
+op_ldr_reg:
+    r[d->reg_d] = r[d->reg_s];
+    NEXT();
+
+op_ldr_ind:
+    r[d->reg_d] = read_word(r[d->reg_s]);
+    NEXT();
+
+op_ldr_disp:
+    r[d->reg_d] = read_word(r[d->reg_s] + d->payload);
+    NEXT();
+
+op_ldr_mem:
+    r[d->reg_d] = read_word(d->payload);
+    NEXT();
+
+op_str_reg:
+    r[d->reg_s] = r[d->reg_d];
+    NEXT();
+
+op_str_ind:
+    write_word(r[d->reg_s], r[d->reg_d]);
+    NEXT();
+
+op_str_disp:
+    write_word(r[d->reg_s] + d->payload, r[d->reg_d]);
+    NEXT();
+
+op_str_mem:
+    write_word(d->payload, r[d->reg_d]);
+    NEXT();
+
+op_push:
+    push(r[d->reg_s]);
+    NEXT();
+
+op_pop:
+    r[d->reg_d] = pop();
+    NEXT();
+
+#undef NEXT
+
+stop:
+    jit = nullptr;
+    std::cout.flush();
+    if(devices)
+        stop_terminal();
+}
+
+void Emulator::poll_devices()
+{
+    std::cout.flush();
+
+    // a character read is kept in term_in until its interrupt is taken
+    if(!terminal_pending && input_open)
+    {
+        struct pollfd input{STDIN_FILENO, POLLIN, 0};
+        char c;
+        if(poll(&input, 1, 0) > 0)
+        {
+            ssize_t count = read(STDIN_FILENO, &c, 1);
+            if(count == 1)
+            {
+                memory[TERM_IN] = 0;
+                memory[TERM_IN + 1] = (uint8_t)c;
+                terminal_pending = true;
+            }
+            else if(count == 0)
+                input_open = false;
+        }
+    }
+
+    if(terminal_pending && !(psw & (PSW_I | PSW_TL)))
+    {
+        terminal_pending = false;
+        interrupt(TERMINAL);
+        return;
+    }
+
+    // the period is read every time, the program can change it at any moment
+    static const int PERIODS[] = {500, 1000, 1500, 2000, 5000, 10000, 30000, 60000};
+    auto now = std::chrono::steady_clock::now();
+    if(now >= next_tick && !(psw & (PSW_I | PSW_TR)))
+    {
+        next_tick = now + std::chrono::milliseconds(PERIODS[read_word(TIM_CFG) & 7]);
+        interrupt(TIMER);
+    }
+}
+
+void Emulator::start_terminal()
+{
+    // characters are passed on as they are typed, without echo
+    terminal_started = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_terminal) == 0;
+    if(!terminal_started)
+        return;
+
+    struct termios raw = saved_terminal;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+}
+
+void Emulator::stop_terminal()
+{
+    if(terminal_started)
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_terminal);
+    terminal_started = false;
+}
+
+void Emulator::print_state(std::ostream& out) const
+{
+    out << "Emulated processor state: psw=0b" << std::bitset<16>(psw) << '\n';
+    for(int i = 0; i < 8; i++)
+    {
+        out << "r" << i << "=0x" << std::hex << std::setw(4) << std::setfill('0') << regs[i] << std::dec << std::setfill(' ');
+        out << (i % 4 == 3 ? "\n" : "    ");
+    }
+}
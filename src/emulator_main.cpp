@@ -0,0 +1,66 @@
+#include <iomanip>
+
+#include "../inc/emulator.h"
+#include "../inc/jit.h"
+
+int main(int argc, char* argv[]){
+
+    std::vector<std::string> inputs;
+    uint64_t max_instructions = 0;
+    bool devices = true;
+    bool stats = false;
+    bool translate = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--max" && i + 1 < argc)
+            max_instructions = strtoull(argv[++i], nullptr, 0);
+        else if(arg == "--no-devices")
+            devices = false;
+        else if(arg == "--stats")
+            stats = true;
+        else if(arg == "--jit")
+            translate = true;
+        else
+            inputs.push_back(arg);
+    }
+
+    if(inputs.size() != 1){
+        std::cout << "ERROR starting, usage: emulator [--max instructions] [--no-devices] [--jit] [--stats] program.hex" << std::endl;
+        return 1;
+    }
+
+    if(translate && !Jit::available()){
+        std::cout << "ERROR starting, --jit needs an x86-64 host" << std::endl;
+        return 1;
+    }
+
+    Emulator emulator;
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        emulator.load_hex(inputs.at(0));
+        start = std::chrono::steady_clock::now();
+        emulator.run(max_instructions, devices, translate);
+    }
+    catch(const AssemblerError& e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::endl << "------------------------------------------------" << std::endl;
+    if(emulator.halted())
+        std::cout << "Emulated processor executed halt instruction" << std::endl;
+    else
+        std::cout << "Emulated processor stopped after " << emulator.executed() << " instructions" << std::endl;
+    emulator.print_state(std::cout);
+
+    if(stats)
+        std::cerr << emulator.executed() << " instructions in " << std::fixed << std::setprecision(3) << seconds << " s, "
+                  << std::setprecision(1) << emulator.executed() / seconds / 1e6 << " million per second" << std::endl;
+
+    return emulator.halted() ? 0 : 1;
+}
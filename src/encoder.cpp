@@ -0,0 +1,486 @@
+#include "../inc/encoder.h"
+
+Encoder::Encoder(Parser* _parser, const SymbolTable& _symbol_table, std::vector<Section>& _sections, RelocationTable& _relocation_table) :
+Pass(_parser), symbol_table(_symbol_table), sections(_sections), relocation_table(_relocation_table), forward_references(false)
+{
+    // the assembler puts it in the pool before any pass starts
+    current_section_id = symbol_table.names().find(BLANK_SECTION);
+}
+
+void Encoder::encode(const std::vector<std::string_view>& lines, size_t first, size_t last, int section)
+{
+    line_counter = first + 1;
+    end_reached = false;
+    current_section_id = section;
+    current_section_index = -1;
+
+    for(size_t i = first; i < last; i++)
+    {
+        std::string_view line = lines[i];
+
+        // ignore empty lines
+        if(line.empty())
+        {
+            line_counter++;
+            continue;
+        }
+
+        line_tokens.clear();
+        parser->tokenize(line, line_tokens); 
+        token_counter = 0;
+
+        // just a comment line, go next
+        if(line_tokens.size() == 0){
+            line_counter++;
+            continue;
+        }
+
+        // ignore labels
+        if(line_tokens.at(token_counter).back() == ':'){
+            token_counter++;
+        }
+
+        // reached eol
+        if(token_counter == line_tokens.size())
+        {
+            line_counter++;
+            continue;
+        }
+
+        directive_handler_sp();
+
+        // reached eol
+        if(token_counter == line_tokens.size() || end_reached)
+        {
+            line_counter++;
+            continue;
+        }
+
+        instruction_handler_sp();
+
+        line_counter++;
+        if(end_reached)
+            break;
+    }
+}
+
+void Encoder::encode_line(const std::vector<std::string_view>& tokens, uint first_token, uint line)
+{
+    line_tokens = tokens;
+    token_counter = first_token;
+    line_counter = line;
+
+    directive_handler_sp();
+    // not a directive
+    if(token_counter == first_token)
+        instruction_handler_sp();
+}
+
+void Encoder::allow_forward_references()
+{
+    forward_references = true;
+}
+
+void Encoder::add_fixup(std::string_view label, RelocationType relocation_type)
+{
+    Section& section = current_data();
+
+    // reserve the relocation now so relocations stay in the order the two pass engine writes them
+    int relocation = relocation_table.add(current_section_index, section.length(), relocation_type, -1);
+
+    auto head = fixup_heads.emplace(std::string(label), -1).first;
+    fixups.push_back(Fixup(current_section_index, section.data.size(), relocation, line_counter, head->second));
+    head->second = fixups.size() - 1;
+
+    // patched once the symbol is defined
+    emit_word(0);
+}
+
+void Encoder::resolve_fixups(int symbol)
+{
+    auto head = fixup_heads.find(std::string(symbol_table.label(symbol)));
+    if(head == fixup_heads.end())
+        return;
+
+    for(int i = head->second; i != -1; i = fixups.at(i).next)
+    {
+        const Fixup& fixup = fixups.at(i);
+        std::vector<uint8_t>& data = sections.at(fixup.section).data;
+        int32_t offset = symbol_table.offset(symbol);
+        data.at(fixup.offset) = (offset >> 8) & 0xFF;
+        data.at(fixup.offset + 1) = offset & 0xFF;
+
+        // equ symbols need no relocation, the reserved one is dropped
+        if(symbol_table.section(symbol) == SymbolTable::ABSOLUTE_SECTION)
+            relocation_table.set_symbol(fixup.section, fixup.relocation, RelocationTable::DROPPED);
+        else
+            relocation_table.set_symbol(fixup.section, fixup.relocation, symbol);
+    }
+
+    fixup_heads.erase(head);
+}
+
+void Encoder::finish_fixups()
+{
+    // report the earliest use of a symbol that was never defined
+    if(!fixup_heads.empty())
+    {
+        std::string label;
+        uint line = 0;
+        for(const auto& head : fixup_heads)
+        {
+            for(int i = head.second; i != -1; i = fixups.at(i).next)
+            {
+                if(line == 0 || fixups.at(i).line < line)
+                {
+                    line = fixups.at(i).line;
+                    label = head.first;
+                }
+            }
+        }
+        throw AssemblerError() << "ERROR in line " << line << ", symbol " << label << " undefined";
+    }
+
+    relocation_table.remove_dropped();
+
+    fixups.clear();
+}
+
+void Encoder::directive_handler_sp()
+{
+    // not a directive
+    if(line_tokens.at(token_counter).at(0) != '.')
+        return;
+
+    // consume directive, the first pass checked it exists
+    const Directive* info = find_directive(line_tokens.at(token_counter));
+    token_counter++;
+
+    switch(info->kind)
+    {
+    case DirectiveKind::SECTION:
+        section_handler_sp();
+        break;
+    case DirectiveKind::WORD:
+        word_handler_sp();
+        break;
+    case DirectiveKind::SKIP:
+        skip_handler_sp();
+        break;
+    case DirectiveKind::GLOBAL:
+    case DirectiveKind::EXTERN:
+    case DirectiveKind::EQU:
+        // skip line
+        token_counter = line_tokens.size();
+        break;
+    case DirectiveKind::END:
+        end_handler();
+        break;
+    }
+}
+
+void Encoder::section_handler_sp()
+{
+    // update current section, remove '.'
+    current_section = line_tokens.at(token_counter);
+
+    current_section.erase(std::remove(current_section.begin(), current_section.end(), '.'), current_section.end());
+
+    // the first pass has put every section name in the pool
+    current_section_id = symbol_table.names().find(current_section);
+    current_section_index = find_section(sections, current_section_id);
+    token_counter++;
+}
+
+void Encoder::word_handler_sp()
+{
+    int val;
+    if(Lexer::is_literal(line_tokens.at(token_counter), &val))
+    {
+        // insert into object code
+        emit_word(val);
+        token_counter++;
+    }
+    else
+    {
+        while(token_counter < line_tokens.size())
+        {
+            emit_symbol(line_tokens.at(token_counter), RelocationType::ABSOLUTE_16);
+            token_counter++;
+        }
+    }
+}
+
+void Encoder::skip_handler_sp()
+{
+    int val = literal_to_number(line_tokens.at(token_counter));
+
+    // kept as a zero run, no bytes are written
+    current_data().fill(val);
+
+    token_counter++;
+}
+
+void Encoder::instruction_handler_sp()
+{
+    const Instruction* instruction = find_instruction(line_tokens.at(token_counter));
+    if(instruction == nullptr)
+        return;
+
+    switch(instruction->format)
+    {
+    case Format::NONE:
+        token_counter++;
+        emit_byte(instruction->opcode);
+        break;
+    case Format::INT:
+        token_counter++;
+        emit_byte(instruction->opcode);
+        emit_byte(extract_register_num(line_tokens.at(token_counter)) << 4 | 0xF);
+        token_counter++;
+        break;
+    case Format::REG:
+        token_counter++;
+        emit_byte(instruction->opcode);
+        emit_byte(extract_register_num(line_tokens.at(token_counter)) << 4);
+        token_counter++;
+        break;
+    case Format::REG_PAIR:
+        twobyte_handler_sp(instruction->opcode);
+        break;
+    case Format::BRANCH:
+        branch_handler_sp(instruction->opcode);
+        break;
+    case Format::DATA:
+        mem_handler_sp(instruction->opcode);
+        break;
+    case Format::STACK:
+        stack_handler_sp(instruction->opcode);
+        break;
+    }
+}
+
+// handles instructions sized 2 bytes, needs instruction opcode
+void Encoder::twobyte_handler_sp(uint8_t opcode)
+{
+    token_counter++;
+    emit_byte(opcode);
+
+    // first register
+    int reg_d = extract_register_num(line_tokens.at(token_counter));
+    token_counter++;
+    // second register
+    int reg_s = extract_register_num(line_tokens.at(token_counter));
+    token_counter++;
+
+    emit_byte(reg_d << 4 | reg_s);
+}
+
+void Encoder::branch_handler_sp(uint8_t opcode)
+{
+    token_counter++;
+
+    std::string_view temp_token = line_tokens.at(token_counter);
+
+    // there may be spaces in [r0 + 0x12], so form an expression
+    std::string expression;
+    if(temp_token.rfind("*[", 0) == 0 && temp_token.back() != ']')
+    {
+        expression = form_expression();
+        temp_token = expression;
+    }
+
+    emit_byte(opcode);
+
+    // branches have no destination register, it is always F
+    Operand op = Lexer::branch_operand(temp_token);
+    switch(op.mode)
+    {
+    // immediate literal
+    case OperandMode::LITERAL:
+        emit_byte(0xF0);
+        emit_byte(0x00);
+        emit_word(op.literal);
+        break;
+    // immediate symbol
+    case OperandMode::SYMBOL:
+        emit_byte(0xF0);
+        emit_byte(0x00);
+        emit_symbol(op.symbol, RelocationType::ABSOLUTE_16);
+        break;
+    // pc relative symbol, r7 is the pc
+    case OperandMode::PCREL:
+        emit_byte(0xF7);
+        emit_byte(0x05);
+        emit_symbol(op.symbol, RelocationType::PCREL_16);
+        break;
+    case OperandMode::MEM_LITERAL:
+        emit_byte(0xF0);
+        emit_byte(0x04);
+        emit_word(op.literal);
+        break;
+    case OperandMode::MEM_SYMBOL:
+        emit_byte(0xF0);
+        emit_byte(0x04);
+        emit_symbol(op.symbol, RelocationType::ABSOLUTE_16);
+        break;
+    case OperandMode::REG_DIR:
+        emit_byte(0xF0 | op.reg);
+        emit_byte(0x01);
+        break;
+    case OperandMode::REG_IND:
+        emit_byte(0xF0 | op.reg);
+        emit_byte(0x02);
+        break;
+    case OperandMode::REG_IND_LITERAL:
+        emit_byte(0xF0 | op.reg);
+        emit_byte(0x03);
+        emit_word(op.literal);
+        break;
+    case OperandMode::REG_IND_SYMBOL:
+        emit_byte(0xF0 | op.reg);
+        emit_byte(0x03);
+        emit_symbol(op.symbol, RelocationType::ABSOLUTE_16);
+        break;
+    default:
+        break;
+    }
+}
+
+void Encoder::stack_handler_sp(uint8_t opcode)
+{
+    token_counter++;
+    int reg = extract_register_num(line_tokens.at(token_counter));
+
+    // r6 is the stack pointer, push is a store and pop a load
+    emit_byte(opcode);
+    if(opcode == STORE_OPCODE)
+    {
+        emit_byte(0x60 | reg);
+        emit_byte(0x22);
+    }
+    else
+    {
+        emit_byte(reg << 4 | 0x6);
+        emit_byte(0x32);
+    }
+
+    token_counter++;
+}
+
+void Encoder::mem_handler_sp(uint8_t opcode)
+{
+    token_counter++;
+
+    // parse first operand
+    int reg_d = extract_register_num(line_tokens.at(token_counter));
+
+    token_counter++;
+    std::string_view temp_token = line_tokens.at(token_counter);
+
+    // there may be spaces [r0 +0x1], so form and expression
+    std::string expression;
+    if(temp_token.at(0) == '[' && temp_token.back() != ']')
+    {
+        expression = form_expression();
+        temp_token = expression;
+    }
+
+    Operand op = Lexer::data_operand(temp_token);
+    if(opcode == STORE_OPCODE && (op.mode == OperandMode::LITERAL || op.mode == OperandMode::SYMBOL))
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", cannot store to immediate value";
+    }
+
+    emit_byte(opcode);
+
+    switch(op.mode)
+    {
+    case OperandMode::LITERAL:
+        emit_byte(reg_d << 4);
+        emit_byte(0x00);
+        emit_word(op.literal);
+        break;
+    case OperandMode::SYMBOL:
+        emit_byte(reg_d << 4);
+        emit_byte(0x00);
+        emit_symbol(op.symbol, RelocationType::ABSOLUTE_16);
+        break;
+    case OperandMode::MEM_LITERAL:
+        emit_byte(reg_d << 4);
+        emit_byte(0x04);
+        emit_word(op.literal);
+        break;
+    case OperandMode::MEM_SYMBOL:
+        emit_byte(reg_d << 4);
+        emit_byte(0x04);
+        emit_symbol(op.symbol, RelocationType::ABSOLUTE_16);
+        break;
+    // pc relative symbol, r7 is the pc
+    case OperandMode::PCREL:
+        emit_byte(reg_d << 4 | 0x7);
+        emit_byte(0x03);
+        emit_symbol(op.symbol, RelocationType::PCREL_16);
+        break;
+    case OperandMode::REG_DIR:
+        emit_byte(reg_d << 4 | op.reg);
+        emit_byte(0x01);
+        break;
+    case OperandMode::REG_IND:
+        emit_byte(reg_d << 4 | op.reg);
+        emit_byte(0x02);
+        break;
+    case OperandMode::REG_IND_LITERAL:
+        emit_byte(reg_d << 4 | op.reg);
+        emit_byte(0x03);
+        emit_word(op.literal);
+        break;
+    case OperandMode::REG_IND_SYMBOL:
+        emit_byte(reg_d << 4 | op.reg);
+        emit_byte(0x03);
+        emit_symbol(op.symbol, RelocationType::ABSOLUTE_16);
+        break;
+    default:
+        break;
+    }
+}
+
+Section& Encoder::current_data()
+{
+    // code before the first .section directive
+    if(current_section_index == -1)
+        current_section_index = find_section(sections, current_section_id);
+    return sections.at(current_section_index);
+}
+
+void Encoder::emit_byte(uint8_t byte)
+{
+    current_data().data.push_back(byte);
+}
+
+void Encoder::emit_word(uint16_t word)
+{
+    std::vector<uint8_t>& data = current_data().data;
+    data.push_back(word >> 8);
+    data.push_back(word & 0xFF);
+}
+
+void Encoder::emit_symbol(std::string_view label, RelocationType relocation_type)
+{
+    int symbol = symbol_table.find(label);
+    if(symbol == -1 && forward_references)
+    {
+        add_fixup(label, relocation_type);
+        return;
+    }
+    if(symbol == -1)
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", symbol " << label << " undefined";
+    }
+
+    // the relocation points at the word that has to be patched, equ symbols need none
+    uint offset = current_data().length();
+    if(symbol_table.section(symbol) != SymbolTable::ABSOLUTE_SECTION)
+        relocation_table.add(current_section_index, offset, relocation_type, symbol);
+    emit_word(symbol_table.offset(symbol));
+}
@@ -0,0 +1,70 @@
+#include <array>
+#include <cstring>
+
+#include "../inc/hex.h"
+
+// both digits of every byte value, "00" to "FF"
+static constexpr std::array<char, 512> make_hex_table()
+{
+    const char digits[] = "0123456789ABCDEF";
+    std::array<char, 512> table = {};
+    for(int i = 0; i < 256; i++)
+    {
+        table[2 * i] = digits[i >> 4];
+        table[2 * i + 1] = digits[i & 0xF];
+    }
+    return table;
+}
+
+static constexpr std::array<char, 512> HEX_TABLE = make_hex_table();
+
+// one full line of zero bytes
+static constexpr char ZERO_LINE[] = "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00\n";
+
+static char* dump_byte(uint8_t byte, size_t column, char* out)
+{
+    memcpy(out, &HEX_TABLE[2 * byte], 2);
+    out[2] = column == 15 ? '\n' : ' ';
+    return out + 3;
+}
+
+void hex_dump(const uint8_t* data, size_t size, size_t column, char* out)
+{
+    size_t i = 0;
+
+    // up to the start of a line
+    for(; i < size && column != 0; i++, column = (column + 1) % 16)
+        out = dump_byte(data[i], column, out);
+
+    // full lines, 16 bytes and no checks in between
+    for(; i + 16 <= size; i += 16)
+    {
+        for(size_t j = 0; j < 16; j++)
+        {
+            memcpy(out, &HEX_TABLE[2 * data[i + j]], 2);
+            out[2] = ' ';
+            out += 3;
+        }
+        out[-1] = '\n';
+    }
+
+    for(; i < size; i++, column++)
+        out = dump_byte(data[i], column, out);
+}
+
+void hex_zeros(size_t size, size_t column, char* out)
+{
+    size_t i = 0;
+
+    for(; i < size && column != 0; i++, column = (column + 1) % 16)
+        out = dump_byte(0, column, out);
+
+    for(; i + 16 <= size; i += 16)
+    {
+        memcpy(out, ZERO_LINE, 48);
+        out += 48;
+    }
+
+    for(; i < size; i++, column++)
+        out = dump_byte(0, column, out);
+}
@@ -0,0 +1,53 @@
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <sys/stat.h>
+
+#include "../inc/include_cache.h"
+
+IncludeCache& IncludeCache::shared()
+{
+    static IncludeCache cache;
+    return cache;
+}
+
+std::string IncludeCache::normalize(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path normal = std::filesystem::weakly_canonical(path, error);
+    return error ? path : normal.string();
+}
+
+std::shared_ptr<const IncludeFile> IncludeCache::get(const std::string& path)
+{
+    // one entry however the file is named, ./a.s and a.s are the same
+    std::string key = normalize(path);
+
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        throw AssemblerError() << "ERROR opening include file: " << path;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto entry = entries.find(key);
+        if(entry != entries.end() && entry->second.size == st.st_size &&
+           entry->second.modified.tv_sec == st.st_mtim.tv_sec && entry->second.modified.tv_nsec == st.st_mtim.tv_nsec)
+            return entry->second.file;
+    }
+
+    // read outside the lock, two threads may read the same file at once and the last one is kept;
+    // copied instead of mapped, so a file changed later can't change the lines under an assembly
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream contents;
+    if(!(in && contents << in.rdbuf()) && st.st_size != 0)
+        throw AssemblerError() << "ERROR reading include file: " << path;
+
+    std::shared_ptr<IncludeFile> file(new IncludeFile(path));
+    file->text = contents.str();
+    file->parser.use_text(file->text);
+    file->parser.parse_file(file->lines);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[key] = Entry{st.st_mtim, st.st_size, file};
+    return file;
+}
@@ -0,0 +1,801 @@
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "../inc/jit.h"
+
+#if defined(__x86_64__)
+
+// host registers while translated code runs:
+//     r8-r11, esi, edi, ebp  r0-r6 of the emulator, zero extended
+//     rbx                    the registers of the emulator in memory, r7 is kept there
+//                            and the psw is at a fixed distance from them
+//     r12                    the emulator memory
+//     r13                    instructions left to run
+//     r14                    the code map, nonzero for bytes of decoded instructions
+//     r15                    the blocks, indexed by address
+//     eax, ecx, edx          scratch
+// r0-r6 are loaded by the entry and written back by the exit, every way out goes through it
+static const uint8_t EAX = 0, ECX = 1;
+static const uint8_t HOST[7] = {8, 9, 10, 11, 6, 7, 5};
+
+// returned by the exit, the interpreter runs the next instruction
+static uint8_t* const STOP = (uint8_t*)1;
+
+Jit::Jit(Emulator& _emulator) : emulator(_emulator), blocks(Emulator::MEMORY_SIZE, nullptr), code(Emulator::MEMORY_SIZE, 0),
+budget_left(0), generation(0)
+{
+    psw = (uint8_t*)&emulator.psw - (uint8_t*)emulator.regs;
+
+    void* memory = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(memory == MAP_FAILED)
+        throw AssemblerError() << "ERROR starting the translator, no executable memory";
+    buffer = (uint8_t*)memory;
+    at = buffer;
+
+    // entry(block): save the callee saved registers, keep the stack 16 byte aligned for calls, load the state
+    entry = (uint8_t* (*)(uint8_t*))at;
+    put({0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57}); // push rbx, rbp, r12-r15
+    put({0x48, 0x83, 0xEC, 0x08}); // sub rsp, 8
+    put({0x48, 0xBB}); put64((uint64_t)emulator.regs); // mov rbx, regs
+    put({0x49, 0xBC}); put64((uint64_t)emulator.memory.data()); // mov r12, memory
+    put({0x49, 0xBE}); put64((uint64_t)code.data()); // mov r14, code
+    put({0x49, 0xBF}); put64((uint64_t)blocks.data()); // mov r15, blocks
+    put({0x48, 0xB8}); put64((uint64_t)&budget_left); // mov rax, &budget_left
+    put({0x4C, 0x8B, 0x28}); // mov r13, [rax]
+    put({0x48, 0x89, 0xF8}); // mov rax, rdi, rdi is r5
+    for(int reg = 0; reg < 7; reg++)
+        memory_operand({0x0F, 0xB7}, HOST[reg], reg * 2, false); // movzx host, word [rbx + 2 * reg]
+    put({0xFF, 0xE0}); // jmp rax
+
+    // the exit, rax is what entry returns
+    exit = at;
+    for(int reg = 0; reg < 7; reg++)
+        memory_operand({0x89}, HOST[reg], reg * 2, true); // mov word [rbx + 2 * reg], host
+    put({0x48, 0xB9}); put64((uint64_t)&budget_left); // mov rcx, &budget_left
+    put({0x4C, 0x89, 0x29}); // mov [rcx], r13
+    put({0x48, 0x83, 0xC4, 0x08}); // add rsp, 8
+    put({0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B, 0xC3}); // pop r15-r12, rbp, rbx; ret
+
+    blocks_start = at;
+}
+
+Jit::~Jit()
+{
+    munmap(buffer, BUFFER_SIZE);
+}
+
+bool Jit::available()
+{
+    return true;
+}
+
+uint32_t Jit::run(uint32_t budget)
+{
+    budget_left = budget;
+    uint8_t* patch = nullptr; // the jump of the last exit, it goes to the next block from now on
+    uint64_t patch_generation = generation;
+
+    for(;;)
+    {
+        uint16_t pc = emulator.regs[7];
+        uint8_t* block = blocks[pc];
+        if(block == nullptr)
+            block = translate(pc);
+        if(block == nullptr)
+            break;
+
+        if(patch != nullptr && patch_generation == generation)
+            bind(patch, block);
+
+        uint8_t* result = entry(block);
+        if(result == STOP)
+            break;
+        patch = result;
+        patch_generation = generation;
+    }
+
+    return budget_left;
+}
+
+void Jit::flush()
+{
+    // the code of a block that is running stays where it is until the next translation,
+    // the store that called this leaves the block right after it returns
+    for(uint16_t pc : translated)
+        blocks[pc] = nullptr;
+    translated.clear();
+    at = blocks_start;
+    generation++;
+}
+
+int Jit::store_word(Jit* jit, uint32_t address, uint32_t value)
+{
+    uint64_t before = jit->generation;
+    jit->emulator.write_word(address, value);
+    return jit->generation != before;
+}
+
+// the interpreter keeps halt, int, iret, invalid instructions and the ones that
+// use the pc as an operand of the alu or the stack, only ldr, str and branches read it
+bool Jit::translatable(const Decoded& d)
+{
+    typedef Emulator E;
+    switch(d.op)
+    {
+    case E::UNDECODED: case E::INVALID: case E::HALT: case E::INT: case E::IRET:
+        return false;
+    case E::XCHG: case E::ADD: case E::SUB: case E::MUL: case E::DIV: case E::CMP: case E::NOT:
+    case E::AND: case E::OR: case E::XOR: case E::TEST: case E::SHL: case E::SHR: case E::PUSH: case E::POP:
+        return d.reg_d != 7 && d.reg_s != 7;
+    default:
+        return true;
+    }
+}
+
+bool Jit::branches(const Decoded& d)
+{
+    typedef Emulator E;
+    return d.op == E::CALL || d.op == E::RET || d.op == E::JMP || d.op == E::JEQ || d.op == E::JNE || d.op == E::JGT;
+}
+
+bool Jit::writes_pc(const Decoded& d)
+{
+    typedef Emulator E;
+    if(branches(d))
+        return true;
+    switch(d.op)
+    {
+    case E::LDR_IMM: case E::LDR_REG: case E::LDR_IND: case E::LDR_DISP: case E::LDR_MEM:
+        return d.reg_d == 7;
+    case E::STR_REG:
+        return d.reg_s == 7;
+    default:
+        return false;
+    }
+}
+
+// the psw bits an instruction sets
+uint16_t Jit::sets_flags(const Decoded& d)
+{
+    typedef Emulator E;
+    switch(d.op)
+    {
+    case E::CMP: return E::PSW_Z | E::PSW_O | E::PSW_C | E::PSW_N;
+    case E::TEST: return E::PSW_Z | E::PSW_N;
+    case E::SHL: case E::SHR: return E::PSW_Z | E::PSW_C | E::PSW_N;
+    default: return 0;
+    }
+}
+
+// stores can leave the block through write_word and a division by zero leaves it before it runs
+bool Jit::may_leave(const Decoded& d)
+{
+    typedef Emulator E;
+    return d.op == E::DIV || d.op == E::STR_IND || d.op == E::STR_DISP || d.op == E::STR_MEM || d.op == E::PUSH || d.op == E::CALL;
+}
+
+uint8_t* Jit::translate(uint16_t pc)
+{
+    // the instructions of the block, up to and with the first one that changes the pc
+    std::vector<Decoded> instructions;
+    std::vector<uint16_t> addresses;
+    uint32_t address = pc;
+    while(instructions.size() < MAX_BLOCK && address < Emulator::MEMORY_SIZE)
+    {
+        Decoded d = emulator.decode(address);
+        if(!translatable(d) || address + d.size > Emulator::MEMORY_SIZE)
+            break;
+        instructions.push_back(d);
+        addresses.push_back(address);
+        address += d.size;
+        if(writes_pc(d))
+            break;
+    }
+    if(instructions.empty())
+        return nullptr;
+
+    // flags that are set again before anything can see them are not computed,
+    // everything is seen once the block is left
+    uint32_t count = instructions.size();
+    std::vector<uint16_t> live(count);
+    uint16_t seen = 0xFFFF;
+    for(uint32_t i = count; i-- > 0;)
+    {
+        live[i] = seen & sets_flags(instructions[i]);
+        seen &= ~sets_flags(instructions[i]);
+        if(may_leave(instructions[i]) || branches(instructions[i]))
+            seen = 0xFFFF;
+    }
+
+    if(at + BLOCK_RESERVE > buffer + BUFFER_SIZE)
+        flush();
+
+    uint8_t* block = at;
+    enter_block(pc, count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const Decoded& d = instructions[i];
+        mark(addresses[i], d.size);
+        translate(d, addresses[i], addresses[i] + d.size, count - i - 1, live[i]);
+    }
+
+    // a block that ends with a branch has left already
+    if(!writes_pc(instructions.back()))
+        exit_to(addresses.back() + instructions.back().size);
+
+    blocks[pc] = block;
+    translated.push_back(pc);
+    return block;
+}
+
+// refund: instructions of the block after this one, given back if the block is left early
+// live: the flags it sets that are used
+void Jit::translate(const Decoded& d, uint16_t pc, uint16_t next, uint32_t refund, uint16_t live)
+{
+    typedef Emulator E;
+    uint8_t dst = d.reg_d < 7 ? HOST[d.reg_d] : 0;
+    uint8_t src = d.reg_s < 7 ? HOST[d.reg_s] : 0;
+    uint8_t sp = HOST[6];
+
+    switch(d.op)
+    {
+    case E::XCHG:
+        registers({0x87}, src, dst);
+        break;
+
+    case E::ADD: case E::SUB:
+        registers({(uint8_t)(d.op == E::ADD ? 0x01 : 0x29)}, src, dst);
+        zero_extend(dst, dst);
+        break;
+
+    case E::AND: case E::OR: case E::XOR:
+        registers({(uint8_t)(d.op == E::AND ? 0x21 : d.op == E::OR ? 0x09 : 0x31)}, src, dst);
+        break;
+
+    case E::MUL:
+        registers({0x0F, 0xAF}, dst, src); // imul dst, src
+        zero_extend(dst, dst);
+        break;
+
+    case E::DIV:
+    {
+        // a division by zero is left to the interpreter, it raises the error interrupt
+        registers({0x0F, 0xBF}, ECX, src); // movsx ecx, src16
+        put({0x85, 0xC9}); // test ecx, ecx
+        uint8_t* nonzero = branch({0x0F, 0x85}); // jnz
+        exit_stop(pc, refund + 1);
+        bind(nonzero);
+        registers({0x0F, 0xBF}, EAX, dst); // movsx eax, dst16
+        put({0x99, 0xF7, 0xF9}); // cdq; idiv ecx, 32 bits so -32768 / -1 does not trap
+        zero_extend(dst, EAX);
+        break;
+    }
+
+    case E::CMP:
+        registers({0x39}, src, dst, true); // cmp dst16, src16
+        if(live == 0)
+            break;
+        // the x86 flags are the ones of the emulator, z in al, o in ah, c in cl and n in ch
+        put({0x0F, 0x94, 0xC0, 0x0F, 0x90, 0xC4, 0x0F, 0x92, 0xC1, 0x0F, 0x98, 0xC5});
+        put({0x0F, 0xB6, 0xD4, 0x0F, 0xB6, 0xC0, 0x8D, 0x04, 0x50}); // eax = z | o << 1
+        put({0x0F, 0xB6, 0xD1, 0x8D, 0x04, 0x90}); // | c << 2
+        put({0x0F, 0xB6, 0xD5, 0x8D, 0x04, 0xD0}); // | n << 3
+        flags(E::PSW_Z | E::PSW_O | E::PSW_C | E::PSW_N);
+        break;
+
+    case E::NOT:
+        registers({0x81}, 6, dst); // xor dst, 0xFFFF
+        put32(0xFFFF);
+        break;
+
+    case E::TEST:
+        registers({0x85}, src, dst, true); // test dst16, src16
+        if(live == 0)
+            break;
+        put({0x0F, 0x94, 0xC2, 0x0F, 0x98, 0xC1}); // sete dl; sets cl
+        put({0x0F, 0xB6, 0xC2, 0x0F, 0xB6, 0xD1, 0x8D, 0x04, 0xD0}); // eax = z | n << 3
+        flags(E::PSW_Z | E::PSW_N);
+        break;
+
+    case E::SHL: case E::SHR:
+        // counts above 17 shift everything out like 17 does; shr shifts the value once more
+        // to the left first, so that the bit shifted out last ends up in the carry
+        registers({0x89}, dst, EAX); // mov eax, dst
+        if(d.op == E::SHR)
+            put({0x01, 0xC0}); // add eax, eax
+        registers({0x89}, src, ECX); // mov ecx, src
+        put({0xBA, 0x11, 0x00, 0x00, 0x00, 0x39, 0xD1, 0x0F, 0x47, 0xCA}); // mov edx, 17; cmp ecx, edx; cmova ecx, edx
+        if(d.op == E::SHL)
+        {
+            put({0xD3, 0xE0}); // shl eax, cl
+            zero_extend(dst, EAX);
+            if(live == 0)
+                break;
+            put({0x0F, 0xBA, 0xE0, 0x10, 0x0F, 0x92, 0xC1}); // bt eax, 16; setc cl
+        }
+        else
+        {
+            put({0xD3, 0xE8, 0xD1, 0xE8}); // shr eax, cl; shr eax, 1
+            zero_extend(dst, EAX);
+            if(live == 0)
+                break;
+            put({0x0F, 0x92, 0xC1}); // setc cl
+        }
+        put({0x66, 0x85, 0xC0, 0x0F, 0x94, 0xC2}); // test ax, ax; sete dl
+        put({0x0F, 0xBA, 0xE0, 0x0F, 0x0F, 0x92, 0xC5}); // bt eax, 15; setc ch
+        put({0x0F, 0xB6, 0xC2, 0x0F, 0xB6, 0xD1, 0x8D, 0x04, 0x90}); // eax = z | c << 2
+        put({0x0F, 0xB6, 0xD5, 0x8D, 0x04, 0xD0}); // | n << 3
+        flags(E::PSW_Z | E::PSW_C | E::PSW_N);
+        break;
+
+    case E::LDR_IMM:
+        if(d.reg_d == 7)
+            store_pc_immediate(d.payload);
+        else
+            move_immediate(dst, d.payload);
+        break;
+
+    case E::LDR_REG:
+        get(EAX, d.reg_s, next);
+        set(d.reg_d, EAX);
+        break;
+
+    case E::STR_REG:
+        get(EAX, d.reg_d, next);
+        set(d.reg_s, EAX);
+        break;
+
+    case E::LDR_IND: case E::LDR_DISP: case E::LDR_MEM:
+    case E::STR_IND: case E::STR_DISP: case E::STR_MEM:
+    {
+        bool loads = d.op == E::LDR_IND || d.op == E::LDR_DISP || d.op == E::LDR_MEM;
+        if(!loads)
+            get(ECX, d.reg_d, next);
+
+        // the address, pc relative operands (%symbol) are constant
+        if(d.op == E::LDR_MEM || d.op == E::STR_MEM || ((d.op == E::LDR_DISP || d.op == E::STR_DISP) && d.reg_s == 7))
+            move_immediate(EAX, d.op == E::LDR_MEM || d.op == E::STR_MEM ? d.payload : (uint16_t)(next + d.payload));
+        else
+        {
+            get(EAX, d.reg_s, next);
+            if(d.op == E::LDR_DISP || d.op == E::STR_DISP)
+            {
+                put({0x05}); // add eax, payload
+                put32(d.payload);
+                zero_extend(EAX, EAX);
+            }
+        }
+
+        if(loads)
+        {
+            read();
+            set(d.reg_d, ECX);
+        }
+        else
+            write(refund, next);
+        break;
+    }
+
+    case E::PUSH:
+        registers({0x89}, src, ECX); // mov ecx, src
+        registers({0x83}, 5, sp); // sub sp, 2
+        put({0x02});
+        zero_extend(sp, sp);
+        registers({0x89}, sp, EAX); // mov eax, sp
+        write(refund, next);
+        break;
+
+    case E::POP:
+        registers({0x89}, sp, EAX); // mov eax, sp
+        read();
+        registers({0x83}, 0, sp); // add sp, 2
+        put({0x02});
+        zero_extend(sp, sp);
+        registers({0x89}, ECX, dst); // mov dst, ecx
+        break;
+
+    case E::JMP:
+    {
+        bool constant;
+        uint16_t address;
+        target(d, next, constant, address);
+        jump(constant, address);
+        break;
+    }
+
+    case E::JEQ: case E::JNE: case E::JGT:
+    {
+        // not taken goes on with the next block
+        std::vector<uint8_t*> not_taken;
+        if(d.op == E::JGT)
+        {
+            // signed greater: not equal and n == o
+            put({0x0F, 0xB7}); // movzx eax, psw
+            operand(EAX, psw);
+            put({0xA8, 0x01}); // test al, z
+            not_taken.push_back(branch({0x0F, 0x85})); // jnz
+            put({0x89, 0xC1, 0xC1, 0xE9, 0x02, 0x31, 0xC1, 0xF6, 0xC1, 0x02}); // mov ecx, eax; shr ecx, 2; xor ecx, eax; test cl, o
+            not_taken.push_back(branch({0x0F, 0x85})); // jnz
+        }
+        else
+        {
+            put({0xF6}); // test byte psw, z
+            operand(0, psw);
+            put({(uint8_t)E::PSW_Z});
+            not_taken.push_back(branch({0x0F, (uint8_t)(d.op == E::JEQ ? 0x84 : 0x85)})); // jz or jnz
+        }
+
+        bool constant;
+        uint16_t address;
+        target(d, next, constant, address);
+        jump(constant, address);
+
+        for(uint8_t* rel : not_taken)
+            bind(rel);
+        exit_to(next);
+        break;
+    }
+
+    case E::CALL:
+    {
+        bool constant;
+        uint16_t address;
+        target(d, next, constant, address);
+        // the pc is set before the push, a push that drops the block leaves with it
+        if(constant)
+            store_pc_immediate(address);
+        else
+            store_pc(EAX);
+        move_immediate(ECX, next);
+        registers({0x83}, 5, sp); // sub sp, 2
+        put({0x02});
+        zero_extend(sp, sp);
+        registers({0x89}, sp, EAX); // mov eax, sp
+        write(0, -1);
+        if(constant)
+            exit_to(address);
+        else
+            exit_dynamic();
+        break;
+    }
+
+    case E::RET:
+        registers({0x89}, sp, EAX); // mov eax, sp
+        read();
+        registers({0x83}, 0, sp); // add sp, 2
+        put({0x02});
+        zero_extend(sp, sp);
+        store_pc(ECX);
+        exit_dynamic();
+        break;
+
+    default:
+        break;
+    }
+
+    // ldr r7 and the like jump to what they wrote
+    if(writes_pc(d) && !branches(d))
+        exit_dynamic();
+}
+
+// the target of a branch, either a constant or in eax
+void Jit::target(const Decoded& d, uint16_t next, bool& constant, uint16_t& address)
+{
+    constant = false;
+    address = 0;
+    switch(d.mode)
+    {
+    case 0: // immediate
+        constant = true;
+        address = d.payload;
+        return;
+    case 1: // register
+        get(EAX, d.reg_s, next);
+        return;
+    case 2: // memory at register
+        get(EAX, d.reg_s, next);
+        read();
+        registers({0x89}, ECX, EAX);
+        return;
+    case 3: // memory at register + displacement
+        if(d.reg_s == 7)
+            move_immediate(EAX, (uint16_t)(next + d.payload));
+        else
+        {
+            get(EAX, d.reg_s, next);
+            put({0x05});
+            put32(d.payload);
+            zero_extend(EAX, EAX);
+        }
+        read();
+        registers({0x89}, ECX, EAX);
+        return;
+    case 4: // memory
+        move_immediate(EAX, d.payload);
+        read();
+        registers({0x89}, ECX, EAX);
+        return;
+    default: // register + displacement, pc relative with r7
+        if(d.reg_s == 7)
+        {
+            constant = true;
+            address = next + d.payload;
+            return;
+        }
+        get(EAX, d.reg_s, next);
+        put({0x05});
+        put32(d.payload);
+        return;
+    }
+}
+
+void Jit::jump(bool constant, uint16_t address)
+{
+    if(constant)
+        exit_to(address);
+    else
+    {
+        store_pc(EAX);
+        exit_dynamic();
+    }
+}
+
+// scratch = reg, the pc reads as the address of the next instruction
+void Jit::get(uint8_t scratch, int reg, uint16_t next)
+{
+    if(reg == 7)
+        move_immediate(scratch, next);
+    else
+        registers({0x89}, HOST[reg], scratch);
+}
+
+// reg = scratch, which is zero extended
+void Jit::set(int reg, uint8_t scratch)
+{
+    if(reg == 7)
+        store_pc(scratch);
+    else
+        registers({0x89}, scratch, HOST[reg]);
+}
+
+// ecx = the big endian word at eax, the second byte wraps around to 0
+void Jit::read()
+{
+    put({0x41, 0x0F, 0xB6, 0x0C, 0x04}); // movzx ecx, byte [r12 + rax]
+    put({0x8D, 0x50, 0x01, 0x0F, 0xB7, 0xD2}); // lea edx, [rax + 1]; movzx edx, dx
+    put({0x41, 0x0F, 0xB6, 0x14, 0x14}); // movzx edx, byte [r12 + rdx]
+    put({0xC1, 0xE1, 0x08, 0x09, 0xD1}); // shl ecx, 8; or ecx, edx
+}
+
+// the word in cx to eax; memory mapped registers and code go through write_word,
+// if that drops the blocks this one is left with the pc at next (-1: the pc is already set)
+void Jit::write(uint32_t refund, int next)
+{
+    put({0x3D}); // cmp eax, TERM_OUT
+    put32(Emulator::TERM_OUT);
+    uint8_t* registers = branch({0x0F, 0x83}); // jae
+    put({0x66, 0x41, 0x83, 0x3C, 0x06, 0x00}); // cmp word [r14 + rax], 0
+    uint8_t* code_bytes = branch({0x0F, 0x85}); // jne
+    put({0x66, 0xC1, 0xC1, 0x08}); // rol cx, 8
+    put({0x66, 0x41, 0x89, 0x0C, 0x04}); // mov [r12 + rax], cx
+    uint8_t* done = branch({0xE9});
+
+    // the registers the call may change are saved, 48 bytes keep the stack aligned
+    bind(registers);
+    bind(code_bytes);
+    put({0x56, 0x57, 0x41, 0x50, 0x41, 0x51, 0x41, 0x52, 0x41, 0x53}); // push rsi, rdi, r8-r11
+    put({0x89, 0xC6, 0x0F, 0xB7, 0xD1}); // mov esi, eax; movzx edx, cx
+    put({0x48, 0xBF}); // mov rdi, this
+    put64((uint64_t)this);
+    put({0x48, 0xB8}); // mov rax, store_word
+    put64((uint64_t)&Jit::store_word);
+    put({0xFF, 0xD0}); // call rax
+    put({0x41, 0x5B, 0x41, 0x5A, 0x41, 0x59, 0x41, 0x58, 0x5F, 0x5E}); // pop r11-r8, rdi, rsi
+    put({0x85, 0xC0}); // test eax, eax
+    uint8_t* kept = branch({0x0F, 0x84}); // jz
+    if(refund != 0)
+    {
+        put({0x49, 0x81, 0xC5}); // add r13, refund
+        put32(refund);
+    }
+    if(next >= 0)
+        store_pc_immediate(next);
+    put({0x31, 0xC0}); // xor eax, eax
+    bind(branch({0xE9}), exit);
+
+    bind(done);
+    bind(kept);
+}
+
+// eax holds the new bits of mask
+void Jit::flags(uint16_t mask)
+{
+    put({0x66, 0x83}); // and word psw, ~mask
+    operand(4, psw);
+    put({(uint8_t)~mask});
+    put({0x66, 0x09}); // or word psw, ax
+    operand(EAX, psw);
+}
+
+// a block takes its instructions from the budget at once, or leaves them to the interpreter
+void Jit::enter_block(uint16_t pc, uint32_t count)
+{
+    put({0x49, 0x81, 0xED}); // sub r13, count
+    put32(count);
+    uint8_t* enough = branch({0x0F, 0x83}); // jae
+    put({0x49, 0x81, 0xC5}); // add r13, count
+    put32(count);
+    store_pc_immediate(pc);
+    put({0x48, 0xB8}); // mov rax, STOP
+    put64((uint64_t)STOP);
+    bind(branch({0xE9}), exit);
+    bind(enough);
+}
+
+// to a known address: the jump goes to the block once it is translated,
+// until then it leaves with its own address so that run() can set it
+void Jit::exit_to(uint16_t pc)
+{
+    uint8_t* rel = branch({0xE9});
+    if(blocks[pc] != nullptr)
+    {
+        bind(rel, blocks[pc]);
+        return;
+    }
+    bind(rel);
+    store_pc_immediate(pc);
+    put({0x48, 0xB8}); // mov rax, rel
+    put64((uint64_t)rel);
+    bind(branch({0xE9}), exit);
+}
+
+// to the pc in memory, through the blocks
+void Jit::exit_dynamic()
+{
+    put({0x0F, 0xB7}); // movzx eax, pc
+    operand(EAX, 14);
+    put({0x49, 0x8B, 0x04, 0xC7}); // mov rax, [r15 + rax * 8]
+    put({0x48, 0x85, 0xC0}); // test rax, rax
+    uint8_t* missing = branch({0x0F, 0x84}); // jz
+    put({0xFF, 0xE0}); // jmp rax
+    bind(missing);
+    put({0x31, 0xC0}); // xor eax, eax
+    bind(branch({0xE9}), exit);
+}
+
+// the interpreter runs the instruction at pc
+void Jit::exit_stop(uint16_t pc, uint32_t refund)
+{
+    put({0x49, 0x81, 0xC5}); // add r13, refund
+    put32(refund);
+    store_pc_immediate(pc);
+    put({0x48, 0xB8}); // mov rax, STOP
+    put64((uint64_t)STOP);
+    bind(branch({0xE9}), exit);
+}
+
+void Jit::put(std::initializer_list<uint8_t> bytes)
+{
+    for(uint8_t byte : bytes)
+        *at++ = byte;
+}
+
+void Jit::put16(uint16_t value)
+{
+    memcpy(at, &value, 2);
+    at += 2;
+}
+
+void Jit::put32(uint32_t value)
+{
+    memcpy(at, &value, 4);
+    at += 4;
+}
+
+void Jit::put64(uint64_t value)
+{
+    memcpy(at, &value, 8);
+    at += 8;
+}
+
+void Jit::operand(uint8_t reg, int32_t displacement)
+{
+    if(displacement >= -128 && displacement <= 127)
+    {
+        put({(uint8_t)(0x40 | (reg & 7) << 3 | 3), (uint8_t)displacement});
+        return;
+    }
+    put({(uint8_t)(0x80 | (reg & 7) << 3 | 3)});
+    put32(displacement);
+}
+
+// opcode reg, [rbx + displacement], 16 bits wide with word
+void Jit::memory_operand(std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t displacement, bool word)
+{
+    if(word)
+        put({0x66});
+    if(reg >= 8)
+        put({0x44}); // rex.r
+    put(opcode);
+    operand(reg, displacement);
+}
+
+// opcode with two registers, reg in the middle of the modrm byte and rm at its end
+void Jit::registers(std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t rm, bool word)
+{
+    if(word)
+        put({0x66});
+    if(reg >= 8 || rm >= 8)
+        put({(uint8_t)(0x40 | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0))});
+    put(opcode);
+    put({(uint8_t)(0xC0 | (reg & 7) << 3 | (rm & 7))});
+}
+
+// movzx to, from16
+void Jit::zero_extend(uint8_t to, uint8_t from)
+{
+    registers({0x0F, 0xB7}, to, from);
+}
+
+void Jit::move_immediate(uint8_t reg, uint32_t value)
+{
+    if(reg >= 8)
+        put({0x41});
+    put({(uint8_t)(0xB8 | (reg & 7))});
+    put32(value);
+}
+
+void Jit::store_pc(uint8_t scratch)
+{
+    put({0x66, 0x89}); // mov word pc, scratch
+    operand(scratch, 14);
+}
+
+void Jit::store_pc_immediate(uint16_t value)
+{
+    put({0x66, 0xC7}); // mov word pc, value
+    operand(0, 14);
+    put16(value);
+}
+
+uint8_t* Jit::branch(std::initializer_list<uint8_t> opcode)
+{
+    put(opcode);
+    uint8_t* rel = at;
+    put32(0);
+    return rel;
+}
+
+void Jit::bind(uint8_t* rel, const uint8_t* target)
+{
+    int32_t distance = target - (rel + 4);
+    memcpy(rel, &distance, 4);
+}
+
+#else
+
+Jit::Jit(Emulator& _emulator) : emulator(_emulator)
+{
+    throw AssemblerError() << "ERROR starting the translator, it needs an x86-64 host";
+}
+
+Jit::~Jit()
+{
+}
+
+bool Jit::available()
+{
+    return false;
+}
+
+uint32_t Jit::run(uint32_t budget)
+{
+    return budget;
+}
+
+void Jit::flush()
+{
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include <cstdint>
+
+#include "../inc/lexer.h"
+#include "../inc/stats.h"
+
+Operand Lexer::branch_operand(std::string_view token)
+{
+    STAT_ADD(OPERANDS, 1);
+    if(token.empty())
+        return Operand();
+
+    if(token.front() == '%')
+    {
+        Operand op;
+        if(is_symbol(token.substr(1)))
+        {
+            op.mode = OperandMode::PCREL;
+            op.symbol = token.substr(1);
+        }
+        return op;
+    }
+
+    if(token.front() == '*')
+    {
+        std::string_view rest = token.substr(1);
+
+        if(!rest.empty() && rest.front() == '[')
+            return scan_indirect(rest);
+
+        Operand op;
+        if(is_register(rest, 7, &op.reg))
+        {
+            op.mode = OperandMode::REG_DIR;
+            return op;
+        }
+
+        return scan_value(rest, OperandMode::MEM_LITERAL, OperandMode::MEM_SYMBOL);
+    }
+
+    return scan_value(token, OperandMode::LITERAL, OperandMode::SYMBOL);
+}
+
+Operand Lexer::data_operand(std::string_view token)
+{
+    STAT_ADD(OPERANDS, 1);
+    if(token.empty())
+        return Operand();
+
+    if(token.front() == '$')
+        return scan_value(token.substr(1), OperandMode::LITERAL, OperandMode::SYMBOL);
+
+    if(token.front() == '%')
+    {
+        Operand op;
+        if(is_symbol(token.substr(1)))
+        {
+            op.mode = OperandMode::PCREL;
+            op.symbol = token.substr(1);
+        }
+        return op;
+    }
+
+    if(token.front() == '[')
+        return scan_indirect(token);
+
+    Operand op;
+    if(is_register(token, 7, &op.reg))
+    {
+        op.mode = OperandMode::REG_DIR;
+        return op;
+    }
+
+    return scan_value(token, OperandMode::MEM_LITERAL, OperandMode::MEM_SYMBOL);
+}
+
+Operand Lexer::scan_indirect(std::string_view token)
+{
+    Operand op;
+
+    // shortest form is [rX]
+    if(token.size() < 4 || token.front() != '[' || token.back() != ']')
+        return op;
+
+    std::string_view inner = token.substr(1, token.size() - 2);
+    int reg;
+    if(!is_register(inner.substr(0, 2), 7, &reg))
+        return op;
+
+    // [rX]
+    if(inner.size() == 2)
+    {
+        op.mode = OperandMode::REG_IND;
+        op.reg = reg;
+        return op;
+    }
+
+    // [rX + value], spaces around '+' are optional
+    size_t pos = 2;
+    if(pos < inner.size() && inner[pos] == ' ')
+        pos++;
+    if(pos == inner.size() || inner[pos] != '+')
+        return op;
+    pos++;
+    if(pos < inner.size() && inner[pos] == ' ')
+        pos++;
+
+    op = scan_value(inner.substr(pos), OperandMode::REG_IND_LITERAL, OperandMode::REG_IND_SYMBOL);
+    if(op.mode != OperandMode::INVALID)
+        op.reg = reg;
+    return op;
+}
+
+Operand Lexer::scan_value(std::string_view token, OperandMode literal_mode, OperandMode symbol_mode)
+{
+    Operand op;
+    if(is_literal(token, &op.literal))
+    {
+        op.mode = literal_mode;
+    }
+    else if(is_symbol(token))
+    {
+        op.mode = symbol_mode;
+        op.symbol = token;
+    }
+    return op;
+}
+
+bool Lexer::is_literal(std::string_view token, int* value)
+{
+    if(token.empty())
+        return false;
+
+    // 32 bits at most, a longer literal does not wrap
+    uint64_t val = 0;
+
+    // hex, at least one digit after 0x
+    if(token.size() > 2 && token[0] == '0' && (token[1] == 'x' || token[1] == 'X'))
+    {
+        for(size_t i = 2; i < token.size(); i++)
+        {
+            int digit = hex_digit(token[i]);
+            if(digit < 0)
+                return false;
+            val = val * 16 + digit;
+            if(val > UINT32_MAX)
+                return false;
+        }
+    }
+    else
+    {
+        for(char c : token)
+        {
+            if(!is_digit(c))
+                return false;
+            val = val * 10 + (c - '0');
+            if(val > UINT32_MAX)
+                return false;
+        }
+    }
+
+    if(value != nullptr)
+        *value = (int)(uint32_t)val;
+    return true;
+}
+
+bool Lexer::is_symbol(std::string_view token)
+{
+    if(token.empty() || !is_letter(token.front()))
+        return false;
+
+    for(char c : token)
+    {
+        if(!is_letter(c) && !is_digit(c) && c != '_')
+            return false;
+    }
+    return true;
+}
+
+bool Lexer::is_register(std::string_view token, int max_reg, int* reg)
+{
+    if(token.size() != 2 || token[0] != 'r' || token[1] < '0' || token[1] > '0' + max_reg)
+        return false;
+
+    if(reg != nullptr)
+        *reg = token[1] - '0';
+    return true;
+}
+
+int Lexer::hex_digit(char c)
+{
+    if(c >= '0' && c <= '9')
+        return c - '0';
+    if(c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
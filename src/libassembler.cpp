@@ -0,0 +1,46 @@
+#include "../inc/libassembler.h"
+
+MemoryAssembler::MemoryAssembler(bool _one_pass, uint threads) : one_pass(_one_pass), peephole(false), parser("<memory>")
+{
+    assembler.set_threads(threads);
+}
+
+ObjectFile MemoryAssembler::assemble(std::string_view source)
+{
+    ObjectFile object;
+    assemble(source, object);
+    return object;
+}
+
+bool MemoryAssembler::assemble(std::string_view source, ObjectFile& object)
+{
+    object.ok = false;
+    object.diagnostics.clear();
+
+    try
+    {
+        parser.use_text(source);
+        assembler.load(&parser);
+        if(one_pass)
+        {
+            assembler.scan_and_encode();
+        }
+        else
+        {
+            assembler.first_pass();
+            if(peephole)
+                assembler.optimize();
+            assembler.encode_sections();
+        }
+        assembler.export_object(object);
+        object.ok = true;
+    }
+    catch(const AssemblerError& e)
+    {
+        object.sections.clear();
+        object.symbols.clear();
+        object.relocations.clear();
+        object.diagnostics.push_back(assembler.located(e).what());
+    }
+    return object.ok;
+}
@@ -0,0 +1,217 @@
+#include <algorithm>
+
+#include "../inc/linker.h"
+
+Linker::Linker(ThreadPool& _pool) : pool(_pool)
+{
+}
+
+void Linker::place(const std::string& section, uint32_t address)
+{
+    places[section] = address;
+}
+
+void Linker::link(const std::vector<ObjectFile>& objects, const std::vector<std::string>& filenames)
+{
+    lay_out(objects);
+    assign_addresses();
+    define_globals(objects, filenames);
+
+    // every object owns its own bytes of the image, so they are relocated at the same time
+    memory.assign(ADDRESS_SPACE, 0);
+    pool.parallel_for(objects.size(), [&](size_t i)
+    {
+        relocate(objects.at(i), i, filenames.at(i));
+    });
+}
+
+void Linker::lay_out(const std::vector<ObjectFile>& objects)
+{
+    section_names.clear();
+    sections.clear();
+    section_addresses.assign(objects.size(), std::vector<uint32_t>());
+
+    for(size_t i = 0; i < objects.size(); i++)
+    {
+        for(size_t j = 0; j < objects[i].sections.size(); j++)
+        {
+            const ObjectSection& part = objects[i].sections[j];
+            int name = section_names.intern(part.name);
+            if(name == (int)sections.size())
+                sections.push_back(OutputSection{name, 0, 0, {}});
+
+            OutputSection& section = sections.at(name);
+            section.pieces.push_back(Piece{i, j, section.size});
+            // summed in 64 bits, a long list of objects can't wrap it around
+            uint64_t size = (uint64_t)section.size + part.data.size();
+            if(size > ADDRESS_SPACE)
+                throw AssemblerError() << "ERROR linking, section " << part.name << " is larger than the address space";
+            section.size = size;
+        }
+    }
+}
+
+void Linker::assign_addresses()
+{
+    std::vector<OutputSection*> placed;
+    for(OutputSection& section : sections)
+    {
+        auto place = places.find(std::string(section_names.name(section.name)));
+        if(place == places.end())
+            continue;
+        section.address = place->second;
+        placed.push_back(&section);
+    }
+
+    std::sort(placed.begin(), placed.end(), [](const OutputSection* a, const OutputSection* b) { return a->address < b->address; });
+
+    uint64_t next = 0; // after the highest placed section
+    for(size_t i = 0; i < placed.size(); i++)
+    {
+        uint64_t end = (uint64_t)placed[i]->address + placed[i]->size;
+        if(end > ADDRESS_SPACE)
+            throw AssemblerError() << "ERROR linking, section " << section_names.name(placed[i]->name) << " placed at " << placed[i]->address
+                                   << " ends past the address space";
+        if(i + 1 < placed.size() && end > placed[i + 1]->address)
+            throw AssemblerError() << "ERROR linking, sections " << section_names.name(placed[i]->name) << " and "
+                                   << section_names.name(placed[i + 1]->name) << " overlap";
+        next = std::max(next, end);
+    }
+
+    for(OutputSection& section : sections)
+    {
+        if(places.count(std::string(section_names.name(section.name))) != 0)
+            continue;
+        if(next + section.size > ADDRESS_SPACE)
+            throw AssemblerError() << "ERROR linking, section " << section_names.name(section.name) << " does not fit in the address space";
+        section.address = next;
+        next += section.size;
+    }
+
+    // where every object's part of a section starts
+    for(const OutputSection& section : sections)
+        for(const Piece& piece : section.pieces)
+        {
+            std::vector<uint32_t>& addresses = section_addresses.at(piece.object);
+            if(addresses.size() <= piece.section)
+                addresses.resize(piece.section + 1);
+            addresses.at(piece.section) = section.address + piece.offset;
+        }
+}
+
+void Linker::define_globals(const std::vector<ObjectFile>& objects, const std::vector<std::string>& filenames)
+{
+    globals.clear();
+    global_addresses.clear();
+    global_objects.clear();
+
+    for(size_t i = 0; i < objects.size(); i++)
+    {
+        for(const ObjectSymbol& symbol : objects[i].symbols)
+        {
+            if(symbol.scope != 'g' || symbol.section == "UND")
+                continue;
+
+            int id = globals.intern(symbol.label);
+            if(id < (int)global_addresses.size())
+                throw AssemblerError() << "ERROR linking, symbol " << symbol.label << " is defined in " << filenames.at(global_objects.at(id))
+                                       << " and in " << filenames.at(i);
+
+            global_addresses.push_back(symbol_address(objects[i], i, symbol, filenames.at(i)));
+            global_objects.push_back(i);
+        }
+    }
+}
+
+uint32_t Linker::symbol_address(const ObjectFile& object, size_t index, const ObjectSymbol& symbol, const std::string& filename) const
+{
+    if(symbol.section == "ABS")
+        return symbol.offset;
+
+    if(symbol.section == "UND")
+    {
+        int id = globals.find(symbol.label);
+        if(id == -1)
+            throw AssemblerError() << "ERROR linking, symbol " << symbol.label << " used in " << filename << " is not defined";
+        return global_addresses.at(id);
+    }
+
+    // objects have a few sections, a search is faster than a table
+    for(size_t i = 0; i < object.sections.size(); i++)
+        if(object.sections[i].name == symbol.section)
+            return section_addresses.at(index).at(i) + symbol.offset;
+
+    throw AssemblerError() << "ERROR linking, symbol " << symbol.label << " of " << filename << " is in section " << symbol.section
+                           << " that the object does not have";
+}
+
+void Linker::relocate(const ObjectFile& object, size_t index, const std::string& filename)
+{
+    for(size_t i = 0; i < object.sections.size(); i++)
+    {
+        const std::vector<uint8_t>& data = object.sections[i].data;
+        std::copy(data.begin(), data.end(), memory.begin() + section_addresses.at(index).at(i));
+    }
+
+    // relocations come grouped by section, so the section is looked up once per group
+    size_t section = 0;
+    for(const ObjectRelocation& relocation : object.relocations)
+    {
+        if(section >= object.sections.size() || object.sections[section].name != relocation.section)
+        {
+            section = 0;
+            while(section < object.sections.size() && object.sections[section].name != relocation.section)
+                section++;
+            if(section == object.sections.size())
+                throw AssemblerError() << "ERROR linking, " << filename << " has relocations for section " << relocation.section
+                                       << " that it does not have";
+        }
+        if(relocation.offset + 2 > object.sections[section].data.size())
+            throw AssemblerError() << "ERROR linking, relocation at " << relocation.offset << " of " << filename << " is past the end of "
+                                   << relocation.section;
+
+        // the word holds the offset of the symbol in its section plus an addend, words are big endian
+        const ObjectSymbol& symbol = object.symbols.at(relocation.symbol);
+        uint32_t place = section_addresses.at(index).at(section) + relocation.offset;
+        uint16_t word = memory[place] << 8 | memory[place + 1];
+        uint32_t value = symbol_address(object, index, symbol, filename) + (word - symbol.offset);
+
+        // the pc has moved past the word when the instruction uses it
+        if(relocation.type == RelocationType::PCREL_16)
+            value -= place + 2;
+
+        memory[place] = (value >> 8) & 0xFF;
+        memory[place + 1] = value & 0xFF;
+    }
+}
+
+void Linker::write_hex(std::ostream& out) const
+{
+    static const char DIGITS[] = "0123456789ABCDEF";
+
+    // a line is printed if any of its bytes belongs to a section
+    std::vector<bool> lines(ADDRESS_SPACE / 8, false);
+    for(const OutputSection& section : sections)
+        for(uint32_t line = section.address / 8; section.size > 0 && line <= (section.address + section.size - 1) / 8; line++)
+            lines[line] = true;
+
+    std::string text;
+    for(uint32_t line = 0; line < lines.size(); line++)
+    {
+        if(!lines[line])
+            continue;
+
+        uint32_t address = line * 8;
+        for(int shift = 12; shift >= 0; shift -= 4)
+            text += DIGITS[(address >> shift) & 0xF];
+        text += ':';
+        for(uint32_t i = address; i < address + 8; i++)
+        {
+            text += ' ';
+            text += DIGITS[memory[i] >> 4];
+            text += DIGITS[memory[i] & 0xF];
+        }
+        text += '\n';
+    }
+    out << text;
+}
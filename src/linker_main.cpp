@@ -0,0 +1,99 @@
+#include <fstream>
+
+#include "../inc/linker.h"
+#include "../inc/object_reader.h"
+#include "../inc/parser.h"
+
+// -place=section@address, the address is decimal or 0x hex
+static bool parse_place(const std::string& arg, std::string& section, uint32_t& address)
+{
+    size_t at = arg.find('@');
+    if(at == std::string::npos || at == 7)
+        return false;
+
+    section = arg.substr(7, at - 7);
+    std::string number = arg.substr(at + 1);
+    char* end = nullptr;
+    unsigned long value = strtoul(number.c_str(), &end, 0);
+    if(number.empty() || *end != '\0' || value >= Linker::ADDRESS_SPACE)
+        return false;
+    address = value;
+    return true;
+}
+
+int main(int argc, char* argv[]){
+
+    std::vector<std::string> inputs;
+    std::string output_filename;
+    std::vector<std::pair<std::string, uint32_t> > places;
+    int threads = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "-o" && i + 1 < argc)
+            output_filename = argv[++i];
+        else if(arg == "-j" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(arg.compare(0, 7, "-place=") == 0)
+        {
+            std::string section;
+            uint32_t address;
+            if(!parse_place(arg, section, address))
+            {
+                std::cout << "ERROR starting, " << arg << " is not -place=section@address" << std::endl;
+                return 1;
+            }
+            places.push_back(std::make_pair(section, address));
+        }
+        else if(arg.size() > 1 && arg.at(0) == '@')
+        {
+            if(!read_response_file(arg.substr(1), inputs))
+            {
+                std::cout << "ERROR starting, cannot read response file " << arg.substr(1) << std::endl;
+                return 1;
+            }
+        }
+        else
+            inputs.push_back(arg);
+    }
+
+    if(inputs.empty() || output_filename.empty()){
+        std::cout << "ERROR starting, usage: linker [-j threads] [-place=section@address]... -o output.hex input.o... [@response_file]" << std::endl;
+        return 1;
+    }
+
+    if(threads < 0)
+        threads = 0;
+
+    ThreadPool pool(threads);
+    try
+    {
+        // objects are read at the same time, the first broken one is reported
+        std::vector<ObjectFile> objects(inputs.size());
+        pool.parallel_for(inputs.size(), [&](size_t i)
+        {
+            read_object(inputs.at(i), objects.at(i));
+        });
+
+        Linker linker(pool);
+        for(const auto& place : places)
+            linker.place(place.first, place.second);
+        linker.link(objects, inputs);
+
+        std::ofstream outfile(output_filename);
+        linker.write_hex(outfile);
+        if(!(outfile << std::flush))
+        {
+            std::cout << "ERROR writing output file " << output_filename << std::endl;
+            return 1;
+        }
+    }
+    catch(const AssemblerError& e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,28 +1,37 @@
-
-
-#include "../inc/parser.h"
-#include "../inc/assembler.h"
-
+#include "../inc/driver.h"
+#include "../inc/server.h"
 
 int main(int argc, char* argv[]){
 
-    if(argc != 4){
-        std::cout << "ERROR starting, two params required" << std::endl;
-        return 1;
-    }
-
-    std::string input_filename = argv[3];
-    std::string output_filename = argv[2];
-
-    Parser* parser = new Parser(input_filename);
+    std::vector<std::string> args(argv + 1, argv + argc);
 
-    Assembler* as = new Assembler(parser, output_filename);
+    Options options;
+    if(!parse_options(args, options, std::cout))
+        return 1;
 
-    as->first_pass();
-    as->second_pass();
+    if(!options.serve.empty())
+    {
+        if(!options.inputs.empty() || !options.server.empty())
+        {
+            std::cout << "ERROR starting, usage: assembler [-j threads] --serve socket" << std::endl;
+            return 1;
+        }
+        return serve(options.serve, options.threads);
+    }
 
-    delete as;
-    delete parser;
+    // the client only passes its arguments on, the server reads the files
+    if(!options.server.empty())
+    {
+        std::vector<std::string> forwarded;
+        for(size_t i = 0; i < args.size(); i++)
+        {
+            if(args.at(i) == "--server")
+                i++;
+            else if(args.at(i) != "--stop")
+                forwarded.push_back(args.at(i));
+        }
+        return send_request(options.server, forwarded, options.stop);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    return run(options, nullptr, std::cout, std::cerr);
+}
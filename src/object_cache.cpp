@@ -0,0 +1,80 @@
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <unistd.h>
+
+#include "../inc/object_cache.h"
+#include "../inc/sha256.h"
+
+ObjectCache::ObjectCache(std::string _directory) : directory(_directory)
+{
+}
+
+std::string ObjectCache::key(std::string_view source, const std::vector<std::string_view>& includes, const std::string& options) const
+{
+    // the parts are separated by a zero byte, so they can't run into each other
+    Sha256 hash;
+    hash.update(ASSEMBLER_VERSION);
+    hash.update(std::string_view("\0", 1));
+    hash.update(options);
+    hash.update(std::string_view("\0", 1));
+    hash.update(source);
+    // the source names where they go, so their texts in order decide the whole input
+    for(std::string_view include : includes)
+    {
+        hash.update(std::string_view("\0", 1));
+        hash.update(include);
+    }
+    return hash.hex_digest();
+}
+
+std::string ObjectCache::entry(const std::string& key) const
+{
+    // the first two digits split the entries into 256 directories
+    return (std::filesystem::path(directory) / key.substr(0, 2) / (key + ".o")).string();
+}
+
+std::string ObjectCache::temporary(const std::string& near) const
+{
+    static std::atomic<unsigned> counter(0);
+    return near + ".tmp." + std::to_string(getpid()) + "." +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." + std::to_string(counter++);
+}
+
+bool ObjectCache::fetch(const std::string& key, const std::string& output) const
+{
+    std::error_code ec;
+    std::string cached = entry(key);
+    if(!std::filesystem::is_regular_file(cached, ec))
+        return false;
+
+    // copied, not linked: the output may be overwritten in place later,
+    // and the output appears at once, like a freshly written one
+    std::string copy = temporary(output);
+    if(!std::filesystem::copy_file(cached, copy, std::filesystem::copy_options::overwrite_existing, ec))
+    {
+        std::filesystem::remove(copy, ec);
+        return false;
+    }
+    std::filesystem::rename(copy, output, ec);
+    if(ec)
+    {
+        std::filesystem::remove(copy, ec);
+        return false;
+    }
+    return true;
+}
+
+void ObjectCache::store(const std::string& key, const std::string& output) const
+{
+    std::error_code ec;
+    std::string cached = entry(key);
+    std::filesystem::create_directories(std::filesystem::path(cached).parent_path(), ec);
+
+    // readers only ever see a missing or a complete entry
+    std::string copy = temporary(cached);
+    if(std::filesystem::copy_file(output, copy, std::filesystem::copy_options::overwrite_existing, ec))
+        std::filesystem::rename(copy, cached, ec);
+    if(ec)
+        std::filesystem::remove(copy, ec);
+}
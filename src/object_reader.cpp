@@ -0,0 +1,198 @@
+#include <charconv>
+
+#include "../inc/object_reader.h"
+#include "../inc/parser.h"
+
+// the part of a "# ---- NAME ----" line between the dashes
+static std::string_view block_name(std::string_view line)
+{
+    size_t first = line.find_first_not_of("# -");
+    size_t last = line.find_last_not_of(" -");
+    if(first == std::string_view::npos || last < first)
+        return std::string_view();
+    return line.substr(first, last - first + 1);
+}
+
+template<typename T>
+static bool parse_number(std::string_view text, T& value, int base = 10)
+{
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+ObjectBlock block_header(std::string_view line, std::string& section)
+{
+    std::string_view name = block_name(line);
+    if(name == "SYMBOL TABLE")
+        return ObjectBlock::SYMBOLS;
+    if(name == "OBJECT FILE")
+        return ObjectBlock::DATA;
+    if(name.compare(0, 4, "REL.") == 0 && name.size() > 4)
+    {
+        section = std::string(name.substr(4));
+        return ObjectBlock::RELOCATIONS;
+    }
+    return ObjectBlock::NONE;
+}
+
+bool section_header(std::string_view line, std::string& name, uint32_t& size)
+{
+    size_t space = line.find(' ', 3);
+    if(space == std::string_view::npos || !parse_number(line.substr(space + 1), size))
+        return false;
+    name = std::string(line.substr(3, space - 3));
+    return true;
+}
+
+void split_columns(std::string_view line, std::vector<std::string_view>& columns)
+{
+    size_t i = 0;
+    while(i < line.size())
+    {
+        if(line[i] == ' ' || line[i] == '\t' || line[i] == '\r')
+        {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while(i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r')
+            i++;
+        columns.push_back(line.substr(start, i - start));
+    }
+}
+
+bool symbol_row(const std::vector<std::string_view>& columns, size_t number, ObjectSymbol& symbol)
+{
+    size_t row;
+    if(columns.size() != 5 || !parse_number(columns[2], symbol.offset) || columns[3].size() != 1 ||
+       !parse_number(columns[4], row) || row != number)
+        return false;
+
+    symbol.label = std::string(columns[0]);
+    symbol.section = std::string(columns[1]);
+    symbol.scope = columns[3].front();
+    return true;
+}
+
+bool relocation_row(const std::vector<std::string_view>& columns, ObjectRelocation& relocation)
+{
+    if(columns.size() != 3 || !parse_number(columns[0], relocation.offset) || !parse_number(columns[2], relocation.symbol))
+        return false;
+
+    if(columns[1] == relocation_name(RelocationType::ABSOLUTE_16))
+        relocation.type = RelocationType::ABSOLUTE_16;
+    else if(columns[1] == relocation_name(RelocationType::PCREL_16))
+        relocation.type = RelocationType::PCREL_16;
+    else
+        return false;
+    return true;
+}
+
+void read_object(const std::string& filename, ObjectFile& object)
+{
+    object.ok = false;
+    object.diagnostics.clear();
+    object.sections.clear();
+    object.symbols.clear();
+    object.relocations.clear();
+
+    Parser parser(filename);
+    std::vector<std::string_view> lines;
+    parser.parse_file(lines);
+
+    ObjectBlock block = ObjectBlock::NONE;
+    std::string relocation_section;
+    std::vector<uint32_t> sizes; // that the section headers give
+    std::vector<std::string_view> tokens;
+
+    for(size_t i = 0; i < lines.size(); i++)
+    {
+        std::string_view line = lines[i];
+        auto error = [&]() -> AssemblerError
+        {
+            return AssemblerError() << "ERROR reading object file " << filename << ", line " << i + 1 << " is not valid: " << line;
+        };
+
+        // headers are read as they are, the rest is split into columns
+        if(is_block_header(line))
+        {
+            block = block_header(line, relocation_section);
+            if(block == ObjectBlock::NONE)
+                throw error();
+            continue;
+        }
+        if(is_section_header(line))
+        {
+            std::string name;
+            uint32_t size;
+            if(block != ObjectBlock::DATA || !section_header(line, name, size))
+                throw error();
+
+            object.sections.push_back(ObjectSection{name, {}});
+            object.sections.back().data.reserve(size);
+            sizes.push_back(size);
+            continue;
+        }
+
+        tokens.clear();
+        split_columns(line, tokens);
+        if(tokens.empty())
+            continue;
+
+        switch(block)
+        {
+        case ObjectBlock::SYMBOLS:
+        {
+            if(is_symbol_title(tokens))
+                break;
+
+            ObjectSymbol symbol;
+            if(!symbol_row(tokens, object.symbols.size(), symbol))
+                throw error();
+            object.symbols.push_back(symbol);
+            break;
+        }
+        case ObjectBlock::RELOCATIONS:
+        {
+            ObjectRelocation relocation;
+            relocation.section = relocation_section;
+            if(!relocation_row(tokens, relocation))
+                throw error();
+            object.relocations.push_back(relocation);
+            break;
+        }
+        case ObjectBlock::DATA:
+        {
+            if(object.sections.empty())
+                throw error();
+
+            std::vector<uint8_t>& data = object.sections.back().data;
+            for(std::string_view token : tokens)
+            {
+                uint8_t byte;
+                if(token.size() != 2 || !parse_number(token, byte, 16))
+                    throw error();
+                data.push_back(byte);
+            }
+            break;
+        }
+        default:
+            throw error();
+        }
+    }
+
+    for(size_t i = 0; i < object.sections.size(); i++)
+    {
+        if(object.sections[i].data.size() != sizes[i])
+            throw AssemblerError() << "ERROR reading object file " << filename << ", section " << object.sections[i].name
+                                   << " has " << object.sections[i].data.size() << " bytes instead of " << sizes[i];
+    }
+    for(const ObjectRelocation& relocation : object.relocations)
+    {
+        if(relocation.symbol < 0 || relocation.symbol >= (int32_t)object.symbols.size())
+            throw AssemblerError() << "ERROR reading object file " << filename << ", relocation in " << relocation.section
+                                   << " uses symbol " << relocation.symbol << " that does not exist";
+    }
+
+    object.ok = true;
+}
@@ -1,52 +1,147 @@
 #include "../inc/parser.h"
 
-Parser::Parser(std::string _filename) : filename(_filename)
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+Parser::Parser(std::string _filename) : filename(_filename), contents(nullptr), contents_size(0), mapping(nullptr), text_given(false)
 {
 }
 
-void Parser::parse_file(std::vector<std::string>& output)
+Parser::~Parser()
 {
-    std::ifstream file (this->filename);
-    if(file.fail())
+    if(mapping != nullptr)
+        munmap(mapping, contents_size);
+}
+
+void Parser::use_text(std::string_view text)
+{
+    if(mapping != nullptr)
+        munmap(mapping, contents_size);
+    mapping = nullptr;
+    buffer.clear();
+
+    contents = text.data();
+    contents_size = text.size();
+    text_given = true;
+}
+
+void Parser::parse_file(std::vector<std::string_view>& output)
+{
+    if(!text_given)
+        read_file();
+
+    std::string_view text(contents, contents_size);
+    output.reserve(output.size() + std::count(text.begin(), text.end(), '\n') + 1);
+
+    // same lines std::getline would give, no empty line after the last newline
+    size_t start = 0;
+    while(start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if(end == std::string_view::npos)
+            end = text.size();
+
+        output.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+void Parser::read_file()
+{
+    int fd = filename == "-" ? STDIN_FILENO : open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0)
+    {
+        if(fd > STDIN_FILENO)
+            close(fd);
+        throw AssemblerError() << "ERROR opening input file: " << filename;
+    }
+
+    bool read_ok = true;
+    if(S_ISREG(st.st_mode) && st.st_size > 0)
+        read_ok = map_file(fd, st.st_size);
+    else
+        read_ok = read_stream(fd);
+
+    if(fd != STDIN_FILENO)
+        close(fd);
+
+    if(!read_ok)
     {
-        std::cout << "ERROR opening input file: " << filename << std::endl;
-        exit(1);
+        throw AssemblerError() << "ERROR reading input file: " << filename;
     }
-    std::string line;
+}
 
-    while(std::getline(file, line))
+bool Parser::map_file(int fd, size_t size)
+{
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(addr == MAP_FAILED)
     {
-            output.push_back(line);
+        // some file systems can't be mapped
+        return read_stream(fd);
     }
+
+    // lines are read front to back, once per pass
+    madvise(addr, size, MADV_SEQUENTIAL);
+
+    mapping = addr;
+    contents = (const char*)addr;
+    contents_size = size;
+    return true;
 }
 
-void Parser::tokenize(std::string input, std::vector<std::string>& output)
+bool Parser::read_stream(int fd)
 {
-    std::stringstream ss(input);
-    while(ss >> input)
-        output.push_back(input);
+    char chunk[65536];
+    ssize_t n;
+    while((n = read(fd, chunk, sizeof(chunk))) > 0)
+        buffer.append(chunk, n);
 
-    remove_comments(output);
-    remove_commas(output);
+    contents = buffer.data();
+    contents_size = buffer.size();
+    return n == 0;
 }
 
-void Parser::remove_comments(std::vector<std::string>& input)
+void Parser::tokenize(std::string_view input, std::vector<std::string_view>& output) const
 {
-    auto iter = std::find(input.begin(), input.end(), "#");
+    size_t i = 0;
+    while(i < input.size())
+    {
+        if(is_separator(input[i]))
+        {
+            i++;
+            continue;
+        }
 
-    // comment not found
-    if(iter == input.end())
-        return;
-    
-    int remove_from_index = iter - input.begin();
+        // comment, ignore the rest of the line
+        if(input[i] == '#')
+            break;
 
-    // remove all tokens after #
-    input.erase(input.begin() + remove_from_index, input.end());
+        size_t start = i;
+        while(i < input.size() && !is_separator(input[i]) && input[i] != '#')
+            i++;
+
+        output.push_back(input.substr(start, i - start));
+        STAT_ADD(TOKENS, 1);
+    }
 }
 
-void Parser::remove_commas(std::vector<std::string>& input)
+bool Parser::is_separator(char c)
 {
-    for(std::string& token : input){
-        token.erase(std::remove(token.begin(), token.end(), ','), token.end());
-    }
-}
\ No newline at end of file
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f' || c == ',';
+}
+
+bool read_response_file(const std::string& filename, std::vector<std::string>& inputs)
+{
+    std::ifstream file(filename);
+    if(!file)
+        return false;
+
+    std::string name;
+    while(file >> name)
+        inputs.push_back(name);
+    return true;
+}
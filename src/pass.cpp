@@ -0,0 +1,51 @@
+#include "../inc/pass.h"
+
+Pass::Pass(Parser* _parser) : parser(_parser), current_section_id(-1), current_section_index(-1), line_counter(1), token_counter(0), end_reached(false)
+{
+    current_section = BLANK_SECTION;
+}
+
+int Pass::extract_register_num(std::string_view token)
+{
+    // format ce biti rX, gde je x neki broj
+    return token.at(1) - '0';
+}
+
+int Pass::literal_to_number(std::string_view literal)
+{
+    int val;
+    if(!Lexer::is_literal(literal, &val))
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", " << literal << " is not a literal";
+    }
+    return val;
+}
+
+std::string Pass::form_expression()
+{
+    // handle register indirect address mode
+    if(token_counter == line_tokens.size())
+        return std::string(line_tokens.at(token_counter-1));
+
+    std::string expression(line_tokens.at(token_counter));
+    token_counter++;
+    if(expression.back() != ']')
+    {
+        while(expression.back() != ']')
+        {
+            if(token_counter == line_tokens.size())
+            {
+                throw AssemblerError() << "ERROR IN LINE " << line_counter << "unknown addressing mode";
+            }
+            expression += line_tokens.at(token_counter++);
+        }
+    }
+    //std::cout << "returning " << expression << std::endl;
+    return expression;
+}
+
+void Pass::end_handler()
+{
+    //token_counter++;
+    end_reached = true;
+}
@@ -0,0 +1,274 @@
+#include "../inc/peephole.h"
+
+Peephole::Peephole(SymbolTable& _symbol_table, std::vector<Section>& _sections) :
+symbol_table(_symbol_table), sections(_sections), source(nullptr)
+{
+}
+
+void Peephole::clear()
+{
+    cuts.clear();
+    saved.clear();
+    rewritten.clear();
+}
+
+void Peephole::optimize(Parser* parser, std::vector<std::string_view>& lines, size_t last, int section)
+{
+    clear();
+    source = &lines;
+
+    std::unordered_map<int, uint> positions; // where every section left off, for the ones that are reopened
+    uint position = 0; // offset of the next byte in the current section
+    bool counted = false; // the current section has an entry in saved
+    std::vector<Kept> window; // the instructions before this one, back to the last label or directive
+
+    // the first pass checked every line, so the scanner finds no errors here
+    Scanner scanner(parser);
+    for(size_t i = 0; i < last && !scanner.end(); i++)
+    {
+        bool statement = scanner.scan_line(lines[i]);
+        for(const ScanEvent& event : scanner.events())
+        {
+            if(event.kind == ScanEvent::LABEL)
+            {
+                window.clear();
+            }
+            else if(event.kind == ScanEvent::SECTION)
+            {
+                window.clear();
+                positions[section] = position;
+                section = symbol_table.section_id(event.name);
+                position = positions[section];
+                counted = false;
+            }
+        }
+
+        uint offset = position;
+        uint size = scanner.run_size();
+        position += size;
+        scanner.clear();
+
+        if(!statement)
+            continue;
+
+        const std::vector<std::string_view>& tokens = scanner.tokens();
+        uint first = scanner.statement_token();
+        if(tokens.at(first).front() == '.')
+        {
+            window.clear();
+            continue;
+        }
+
+        if(!counted)
+            saving(section);
+        counted = true;
+
+        // only push, pop, ldr and the jumps take part, anything else
+        // keeps the instructions before it apart from the ones after it
+        const Instruction* instruction = find_instruction(tokens.at(first));
+        if(instruction->format != Format::STACK && instruction->format != Format::BRANCH &&
+            (instruction->format != Format::DATA || instruction->opcode != LOAD_OPCODE))
+        {
+            window.clear();
+            continue;
+        }
+
+        Kept k{i, offset, size, instruction, -1, OperandMode::INVALID, -1, "", std::string_view()};
+        if(first > 0)
+            k.label = lines[i].substr(0, tokens.front().data() + tokens.front().size() - lines[i].data());
+
+        switch(k.instruction->format)
+        {
+        case Format::STACK:
+            k.reg = extract_register(tokens.at(first + 1));
+            break;
+        case Format::DATA:
+        {
+            k.reg = extract_register(tokens.at(first + 1));
+            // [r1 + 2] is split into tokens, the first pass puts it together the same way
+            for(size_t j = first + 2; j < tokens.size(); j++)
+                k.text += tokens.at(j);
+            Operand op = Lexer::data_operand(k.text);
+            k.mode = op.mode;
+            k.base = op.reg;
+            break;
+        }
+        case Format::BRANCH:
+        {
+            // a jump to the next instruction goes, call pushes the pc so it stays
+            Operand op = Lexer::branch_operand(tokens.at(first + 1));
+            int symbol = -1;
+            if(k.instruction->mnemonic != "call" && (op.mode == OperandMode::SYMBOL || op.mode == OperandMode::PCREL))
+                symbol = symbol_table.find(op.symbol);
+
+            if(symbol != -1 && symbol_table.section(symbol) == section && symbol_table.offset(symbol) == offset + size)
+                remove(k, section);
+            else
+                window.clear();
+            continue;
+        }
+        default:
+            break;
+        }
+
+        // ldr rX, rX
+        if(is_move(k) && k.mode == OperandMode::REG_DIR && k.base == k.reg)
+        {
+            remove(k, section);
+            continue;
+        }
+
+        // against the instruction before it, and again if that one goes
+        bool removed = false;
+        while(!window.empty() && !removed)
+        {
+            Kept& before = window.back();
+            bool push = before.instruction->format == Format::STACK && before.instruction->opcode == STORE_OPCODE;
+            bool pop = k.instruction->format == Format::STACK && k.instruction->opcode == LOAD_OPCODE;
+            bool load = k.instruction->format == Format::DATA && k.instruction->opcode == LOAD_OPCODE;
+
+            if(push && pop && before.reg == k.reg)
+            {
+                remove(before, section);
+                remove(k, section);
+                window.pop_back();
+                removed = true;
+            }
+            else if(push && pop)
+            {
+                // the value goes through the stack into another register
+                int reg = before.reg;
+                remove(before, section);
+                window.pop_back();
+
+                k.instruction = find_instruction("ldr");
+                k.mode = OperandMode::REG_DIR;
+                k.base = reg;
+                k.text = "r" + std::to_string(reg);
+                rewrite(k, "ldr r" + std::to_string(k.reg) + ", " + k.text);
+            }
+            else if(is_move(before) && load && before.reg == k.reg)
+            {
+                if(before.mode == k.mode && before.text == k.text)
+                {
+                    // the register already holds it
+                    remove(k, section);
+                    removed = true;
+                }
+                else if(!reads(k, k.reg))
+                {
+                    // the first load is never used
+                    remove(before, section);
+                    window.pop_back();
+                }
+                else
+                {
+                    break;
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+        if(!removed)
+            window.push_back(std::move(k));
+    }
+
+    move_symbols();
+}
+
+int Peephole::extract_register(std::string_view token)
+{
+    // rX, the first pass checked it
+    return token.at(1) - '0';
+}
+
+bool Peephole::is_move(const Kept& k) const
+{
+    if(k.instruction->format != Format::DATA || k.instruction->opcode != LOAD_OPCODE || k.reg > 5)
+        return false;
+
+    // the pc changes from one instruction to the next, a load from memory may read a device
+    return k.mode == OperandMode::LITERAL || k.mode == OperandMode::SYMBOL || (k.mode == OperandMode::REG_DIR && k.base <= 5);
+}
+
+bool Peephole::reads(const Kept& k, int reg) const
+{
+    switch(k.mode)
+    {
+    case OperandMode::REG_DIR:
+    case OperandMode::REG_IND:
+    case OperandMode::REG_IND_LITERAL:
+    case OperandMode::REG_IND_SYMBOL:
+        return k.base == reg;
+    default:
+        return false;
+    }
+}
+
+void Peephole::remove(const Kept& k, int section)
+{
+    // the label stays, it is now the label of whatever comes next
+    (*source)[k.line] = k.label;
+
+    cuts[section].push_back(std::make_pair(k.offset, k.size));
+    Saving& s = saving(section);
+    s.instructions++;
+    s.bytes += k.size;
+}
+
+void Peephole::rewrite(const Kept& k, std::string text)
+{
+    if(!k.label.empty())
+        text = std::string(k.label) + " " + text;
+    rewritten.push_back(std::move(text));
+    (*source)[k.line] = rewritten.back();
+}
+
+void Peephole::move_symbols()
+{
+    // bytes removed up to and including every cut, in order of offset
+    for(auto& entry : cuts)
+    {
+        std::vector<std::pair<uint, uint> >& section_cuts = entry.second;
+        std::sort(section_cuts.begin(), section_cuts.end());
+        for(size_t i = 1; i < section_cuts.size(); i++)
+            section_cuts[i].second += section_cuts[i - 1].second;
+    }
+    if(cuts.empty())
+        return;
+
+    // a symbol moves back by the bytes removed before it, one on a removed
+    // instruction ends up on the instruction after it
+    for(size_t i = 0; i < symbol_table.size(); i++)
+    {
+        auto found = cuts.find(symbol_table.section(i));
+        if(found == cuts.end())
+            continue;
+
+        const std::vector<std::pair<uint, uint> >& section_cuts = found->second;
+        uint offset = symbol_table.offset(i);
+        auto after = std::lower_bound(section_cuts.begin(), section_cuts.end(), std::make_pair(offset, 0u));
+        if(after != section_cuts.begin())
+            symbol_table.set_offset(i, offset - (after - 1)->second);
+    }
+
+    for(Section& section : sections)
+    {
+        auto found = cuts.find(section.name);
+        if(found != cuts.end())
+            section.size -= found->second.back().second;
+    }
+}
+
+Peephole::Saving& Peephole::saving(int section)
+{
+    for(Saving& s : saved)
+    {
+        if(s.section == section)
+            return s;
+    }
+    saved.push_back(Saving{section, 0, 0});
+    return saved.back();
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <numeric>
+
+#include "../inc/relocation_table.h"
+
+const char* relocation_name(RelocationType type)
+{
+    return type == RelocationType::PCREL_16 ? "R_HYPO_PC16" : "R_HYPO_16";
+}
+
+RelocationTable::RelocationTable() : count(0)
+{
+}
+
+void RelocationTable::Bucket::push_back(uint32_t offset, RelocationType type, int32_t symbol, uint32_t sequence)
+{
+    if(offsets.size() > 0 && offsets[offsets.size() - 1] > offset)
+        sorted = false;
+
+    offsets.push_back(offset);
+    types.push_back(type);
+    symbols.push_back(symbol);
+    sequences.push_back(sequence);
+}
+
+RelocationTable::Bucket& RelocationTable::bucket(int section)
+{
+    while(buckets.size() <= section)
+        buckets.emplace_back(arena);
+    return buckets[section];
+}
+
+int RelocationTable::add(int section, uint32_t offset, RelocationType type, int32_t symbol)
+{
+    Bucket& records = bucket(section);
+    records.push_back(offset, type, symbol, count++);
+    return records.offsets.size() - 1;
+}
+
+void RelocationTable::append(const RelocationTable& part, const std::vector<int>& sections, const std::vector<uint>& bases)
+{
+    for(size_t s = 0; s < part.buckets.size(); s++)
+    {
+        const Bucket& from = part.buckets[s];
+        if(from.offsets.size() == 0)
+            continue;
+
+        // the part was written after everything already here
+        Bucket& to = bucket(sections.at(s));
+        for(size_t i = 0; i < from.offsets.size(); i++)
+            to.push_back(from.offsets[i] + bases.at(s), from.types[i], from.symbols[i], from.sequences[i] + count);
+    }
+    count += part.count;
+}
+
+size_t RelocationTable::size() const
+{
+    size_t total = 0;
+    for(const Bucket& records : buckets)
+        total += records.offsets.size();
+    return total;
+}
+
+void RelocationTable::remove_dropped()
+{
+    for(Bucket& records : buckets)
+    {
+        size_t kept = 0;
+        for(size_t i = 0; i < records.offsets.size(); i++)
+        {
+            if(records.symbols[i] == DROPPED)
+                continue;
+
+            records.offsets[kept] = records.offsets[i];
+            records.types[kept] = records.types[i];
+            records.symbols[kept] = records.symbols[i];
+            records.sequences[kept] = records.sequences[i];
+            kept++;
+        }
+
+        records.offsets.shrink(kept);
+        records.types.shrink(kept);
+        records.symbols.shrink(kept);
+        records.sequences.shrink(kept);
+    }
+}
+
+std::vector<int> RelocationTable::sections() const
+{
+    std::vector<std::pair<uint32_t, int> > firsts;
+    for(size_t s = 0; s < buckets.size(); s++)
+    {
+        const Bucket& records = buckets[s];
+        if(records.offsets.size() == 0)
+            continue;
+
+        uint32_t first = records.sequences[0];
+        for(size_t i = 1; i < records.sequences.size(); i++)
+            first = std::min(first, records.sequences[i]);
+        firsts.push_back(std::make_pair(first, (int)s));
+    }
+    std::sort(firsts.begin(), firsts.end());
+
+    std::vector<int> order;
+    for(const auto& first : firsts)
+        order.push_back(first.second);
+    return order;
+}
+
+void RelocationTable::clear()
+{
+    buckets.clear();
+    arena.clear();
+    count = 0;
+}
+
+void RelocationTable::sort()
+{
+    for(Bucket& records : buckets)
+    {
+        // records are written in offset order, this only happens if a table was appended out of order
+        if(records.sorted)
+            continue;
+
+        std::vector<size_t> order(records.offsets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return records.offsets[a] < records.offsets[b];
+        });
+
+        std::vector<uint32_t> offsets;
+        std::vector<RelocationType> types;
+        std::vector<int32_t> symbols;
+        std::vector<uint32_t> sequences;
+        for(size_t i : order)
+        {
+            offsets.push_back(records.offsets[i]);
+            types.push_back(records.types[i]);
+            symbols.push_back(records.symbols[i]);
+            sequences.push_back(records.sequences[i]);
+        }
+        for(size_t i = 0; i < order.size(); i++)
+        {
+            records.offsets[i] = offsets[i];
+            records.types[i] = types[i];
+            records.symbols[i] = symbols[i];
+            records.sequences[i] = sequences[i];
+        }
+        records.sorted = true;
+    }
+}
@@ -0,0 +1,393 @@
+#include "../inc/scanner.h"
+
+Scanner::Scanner(Parser* _parser) : Pass(_parser), location_counter(0), first_token(0), end_line_number(0)
+{
+}
+
+void Scanner::scan(const std::vector<std::string_view>& lines, size_t first, size_t last)
+{
+    line_counter = first + 1;
+
+    for(size_t i = first; i < last && !end_reached; i++)
+        scan_line(lines[i]);
+}
+
+bool Scanner::scan_line(std::string_view line)
+{
+    // ignore empty lines
+    if(line.empty())
+    {
+        line_counter++;
+        return false;
+    }
+
+    line_tokens.clear();
+    parser->tokenize(line, line_tokens); 
+    token_counter = 0;
+
+    // just a comment, go to next line
+    if(line_tokens.size() == 0){
+        line_counter++;
+        return false;
+    }
+
+    label_handler();
+    // reached eol
+    if(token_counter == line_tokens.size())
+    {
+        line_counter++;
+        return false;
+    }
+
+    first_token = token_counter;
+    directive_handler();
+    // reached eol
+    if(token_counter == line_tokens.size() || end_reached)
+    {
+        line_counter++;
+        return true;
+    }
+
+    instruction_handler();
+
+    line_counter++;
+    return true;
+}
+
+void Scanner::clear()
+{
+    scan_events.clear();
+    location_counter = 0;
+}
+
+void Scanner::label_handler()
+{
+    // no label in this line
+    if(line_tokens.at(token_counter).back() != ':')
+        return;
+
+    std::string label(line_tokens.at(token_counter));
+    // remove ':'
+    label.erase(std::remove(label.begin(), label.end(), ':'), label.end());
+
+    scan_events.push_back(ScanEvent(ScanEvent::LABEL, label, location_counter, line_counter));
+    token_counter++;
+}
+
+void Scanner::directive_handler()
+{
+    // no directive in this line
+    if(line_tokens.at(token_counter).at(0) != '.')
+        return;
+
+    std::string_view directive = line_tokens.at(token_counter);
+    const Directive* info = find_directive(directive);
+    if(info == nullptr)
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", unkown directive: " << directive;
+    }
+
+    // mneumonic read, go next token
+    token_counter++;
+
+    switch(info->kind)
+    {
+    case DirectiveKind::GLOBAL:
+        global_handler_fp();
+        break;
+    case DirectiveKind::EXTERN:
+        extern_handler_fp();
+        break;
+    case DirectiveKind::SECTION:
+        section_handler_fp();
+        break;
+    case DirectiveKind::WORD:
+        word_handler_fp();
+        break;
+    case DirectiveKind::SKIP:
+        skip_handler_fp();
+        break;
+    case DirectiveKind::EQU:
+        equ_handler_fp();
+        break;
+    case DirectiveKind::END:
+        end_handler();
+        end_line_number = line_counter;
+        break;
+    }
+}
+
+void Scanner::extern_handler_fp()
+{
+
+    if(token_counter == line_tokens.size())
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", no symbol list found";
+    }
+
+    // extern symbols go to the symbol table
+    while(token_counter < line_tokens.size())
+    {
+        // offset should be 0, section undefined
+        scan_events.push_back(ScanEvent(ScanEvent::EXTERN, std::string(line_tokens.at(token_counter)), 0, line_counter));
+        token_counter++;
+    }
+}
+
+void Scanner::section_handler_fp(){
+    if(line_tokens.size() - token_counter != 1)
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", junk after section name detected";
+    }
+
+    // update current section and remove '.'
+    current_section = line_tokens.at(token_counter);
+    current_section.erase(std::remove(current_section.begin(), current_section.end(), '.'), current_section.end());
+
+    // the run of the section we are leaving ends here, a new one starts from 0
+    scan_events.push_back(ScanEvent(ScanEvent::SECTION, current_section, location_counter, line_counter));
+    location_counter = 0;
+
+    // section name read, go next token
+    token_counter++;
+}
+
+void Scanner::word_handler_fp()
+{
+    if(token_counter == line_tokens.size())
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", no word symbol list detected";
+    }
+
+    // check if literal or symbol list
+    if(Lexer::is_literal(line_tokens.at(token_counter)))
+    {
+        token_counter++;
+        if(token_counter != line_tokens.size())
+        {
+            throw AssemblerError() << "ERROR in line " << line_counter << ", junk after literal found";
+        }
+        location_counter += 2;
+    }
+    else
+    {
+        // for each symbol check if format is correct
+        while(token_counter < line_tokens.size())
+        {
+            if(!Lexer::is_symbol(line_tokens.at(token_counter)))
+            {
+                throw AssemblerError() << "ERROR in line " << line_counter << ",  " << line_tokens.at(token_counter) << " is not a symbol";
+            }
+            token_counter++;
+            location_counter += 2;
+        }
+    }
+}
+
+void Scanner::skip_handler_fp()
+{
+    if(token_counter == line_tokens.size())
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", no literal detected after skip";
+    }
+
+    std::string_view temp_token = line_tokens.at(token_counter);
+    int offset;
+    
+    // check for hex value
+    offset = literal_to_number(temp_token);
+    if(offset < 0 || offset > ADDRESS_SPACE)
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", skip size " << temp_token << " out of range";
+    }
+
+    // update lc by the number of bytes skipped
+    location_counter += offset;
+    scan_events.push_back(ScanEvent(ScanEvent::SKIP, "", offset, line_counter));
+
+    token_counter++;
+}
+
+void Scanner::equ_handler_fp()
+{
+    if(line_tokens.size() - token_counter != 2)
+    {
+        throw AssemblerError() << "ERROR in line " << line_counter << ", .equ directive syntax error";
+    }
+
+    // .equ symbol_name, symbol_value
+    std::string_view symbol_label = line_tokens.at(token_counter);
+    token_counter++;
+
+    std::string_view symbol_literal = line_tokens.at(token_counter);
+    int offset;
+
+    // convert literal to integer
+    offset = literal_to_number(symbol_literal);
+
+    scan_events.push_back(ScanEvent(ScanEvent::EQU, std::string(symbol_label), offset, line_counter));
+
+    token_counter++;
+}
+
+void Scanner::global_handler_fp()
+{
+    while(token_counter < line_tokens.size()){
+        if(!Lexer::is_symbol(line_tokens.at(token_counter)))
+        {
+            throw AssemblerError() << "ERROR in line" << line_counter << ", syntax error";
+        }
+        // the symbol may be defined later, it is marked at the end of the pass
+        scan_events.push_back(ScanEvent(ScanEvent::GLOBAL, std::string(line_tokens.at(token_counter)), 0, line_counter));
+        token_counter++;
+    }
+}
+
+void Scanner::instruction_handler()
+{
+    std::string_view instruction_mneumonic = line_tokens.at(token_counter);
+    const Instruction* instruction = find_instruction(instruction_mneumonic);
+    if(instruction == nullptr)
+    {
+        throw AssemblerError() << "ERROR IN LINE " << line_counter << "unknown instruction: " <<  instruction_mneumonic;
+    }
+
+    // mneumonic read, go next token
+    token_counter++;
+
+    switch(instruction->format)
+    {
+    case Format::NONE:
+    {
+        // this is a one word instruction, more words => syntax error
+        if(token_counter != line_tokens.size())
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", junk after " << instruction_mneumonic;
+        }
+        location_counter += instruction->size;
+        break;
+    }
+    case Format::REG_PAIR:
+    {
+        // there should be 2 operands, regD and regS
+        if(line_tokens.size() - token_counter != 2)
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << " incorrect operand format" << instruction_mneumonic;
+        }
+
+        // check first operand
+        if(!Lexer::is_register(line_tokens.at(token_counter++), 5))
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", must use registers, first operand";
+        }
+
+        // check second operand
+        if(!Lexer::is_register(line_tokens.at(token_counter++), 5))
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << " must use register, second operand";
+        }
+
+        location_counter += instruction->size;
+        break;
+    }
+    case Format::REG:
+    case Format::INT:
+    {
+        if(line_tokens.size() - token_counter != 1)
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", incorrect operand format " << instruction_mneumonic;
+        }
+
+        if(!Lexer::is_register(line_tokens.at(token_counter++), 5))
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", registers must be used";
+        }
+
+        location_counter += instruction->size;
+        break;
+    }
+    case Format::BRANCH:
+    {
+        if(token_counter == line_tokens.size())
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", no operand found";
+        }
+
+        // register indirect addressing may contain spaces, concat it into one string
+        std::string operand;
+        if(line_tokens.at(token_counter).rfind("*[", 0) == 0)
+            operand = form_expression();
+        else
+            operand = line_tokens.at(token_counter++);
+
+        if(token_counter != line_tokens.size())
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << "eol junk found!";
+        }
+
+        uint size = operand_size(Lexer::branch_operand(operand), *instruction);
+        if(size == 0)
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << "unknown addressing mode";
+        }
+        location_counter += size;
+        break;
+    }
+    case Format::DATA:
+    {
+        if(token_counter == line_tokens.size() || !Lexer::is_register(line_tokens.at(token_counter++), 7))
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", first operand must be a register";
+        }  
+
+        if(token_counter == line_tokens.size())
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", no operand found";
+        }  
+
+        // concat the expression that may contain spaces into one that does not
+        std::string operand;
+        if(line_tokens.at(token_counter).at(0) == '[')
+            operand = form_expression();
+        else
+            operand = line_tokens.at(token_counter++);
+
+        if(token_counter != line_tokens.size())
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", eol junk found!";
+        }
+
+        uint size = operand_size(Lexer::data_operand(operand), *instruction);
+        if(size == 0)
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", unknown addressing mode";
+        }
+        location_counter += size;
+        break;
+    }
+    case Format::STACK:
+    {
+        if(token_counter == line_tokens.size() || !Lexer::is_register(line_tokens.at(token_counter), 5))
+        {
+            throw AssemblerError() << "ERROR IN LINE " << line_counter << ", a register must be used ";
+        }
+        location_counter += instruction->size;
+        break;
+    }
+    }
+}
+
+uint Scanner::operand_size(const Operand& op, const Instruction& instruction)
+{
+    switch(op.mode)
+    {
+    // no 16 bit word after the register
+    case OperandMode::REG_DIR:
+    case OperandMode::REG_IND:
+        return instruction.size - 2;
+    case OperandMode::INVALID:
+        return 0;
+    default:
+        return instruction.size;
+    }
+}
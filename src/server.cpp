@@ -0,0 +1,299 @@
+#include <iostream>
+#include <sstream>
+#include <iterator>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "../inc/server.h"
+#include "../inc/driver.h"
+#include "../inc/thread_pool.h"
+
+// fields of one message on a connected socket
+class Connection
+{
+public:
+    Connection(int _fd) : fd(_fd), position(0) {}
+
+    // false if the other side closed the connection or sent something broken
+    bool read(std::string& name, std::string& value)
+    {
+        size_t end;
+        while((end = buffer.find('\n', position)) == std::string::npos)
+            if(!fill())
+                return false;
+
+        std::istringstream header(buffer.substr(position, end - position));
+        size_t length;
+        if(!(header >> name >> length))
+            return false;
+        position = end + 1;
+
+        while(buffer.size() - position < length)
+            if(!fill())
+                return false;
+
+        value = buffer.substr(position, length);
+        position += length;
+        return true;
+    }
+
+    bool write(const std::string& name, const std::string& value)
+    {
+        std::string field = name + " " + std::to_string(value.size()) + "\n" + value;
+        size_t written = 0;
+        while(written < field.size())
+        {
+            ssize_t count = ::write(fd, field.data() + written, field.size() - written);
+            if(count < 0 && errno == EINTR)
+                continue;
+            if(count <= 0)
+                return false;
+            written += count;
+        }
+        return true;
+    }
+
+private:
+    bool fill()
+    {
+        // drop what was read already, so a long source is not copied again and again
+        buffer.erase(0, position);
+        position = 0;
+
+        char block[65536];
+        ssize_t count;
+        do
+            count = ::read(fd, block, sizeof(block));
+        while(count < 0 && errno == EINTR);
+        if(count <= 0)
+            return false;
+        buffer.append(block, count);
+        return true;
+    }
+
+    int fd;
+    std::string buffer;
+    size_t position; // of the first byte not read yet
+};
+
+// sockaddr of a path, false if the path is too long for one
+static bool socket_address(const std::string& path, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// run one request and send back its reply; true if it asked the server to stop
+static bool handle(int client, ThreadPool& pool)
+{
+    Connection connection(client);
+    Options options;
+    std::vector<std::string> args;
+    bool stop = false;
+
+    std::string name, value;
+    while(connection.read(name, value) && name != "end")
+    {
+        if(name == "cwd")
+            options.directory = value;
+        else if(name == "arg")
+            args.push_back(value);
+        else if(name == "source")
+        {
+            options.source = value;
+            options.has_source = true;
+        }
+        else if(name == "stop")
+            stop = true;
+    }
+    if(name != "end")
+        return false; // the client is gone
+
+    std::ostringstream out, err;
+    int status = 0;
+    if(!stop)
+    {
+        try
+        {
+            if(!parse_options(args, options, out))
+                status = 1;
+            else if(!options.serve.empty() || !options.server.empty() || options.directory.empty())
+            {
+                out << "ERROR request, a server does not take --serve or --server and needs a cwd" << std::endl;
+                status = 1;
+            }
+            else
+                status = run(options, &pool, out, err);
+        }
+        catch(const std::exception& e)
+        {
+            out << "ERROR " << e.what() << std::endl;
+            status = 1;
+        }
+    }
+
+    connection.write("out", out.str());
+    connection.write("err", err.str());
+    connection.write("status", std::to_string(status));
+    return stop;
+}
+
+int serve(const std::string& socket_path, uint threads)
+{
+    // a client that goes away must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address;
+    if(!socket_address(socket_path, address))
+    {
+        std::cout << "ERROR serving, socket path is too long: " << socket_path << std::endl;
+        return 1;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0)
+    {
+        std::cout << "ERROR serving, cannot create a socket" << std::endl;
+        return 1;
+    }
+
+    // a socket file nobody answers on is left over from a server that died
+    if(connect(listener, (sockaddr*)&address, sizeof(address)) == 0)
+    {
+        std::cout << "ERROR serving, a server is already running on " << socket_path << std::endl;
+        close(listener);
+        return 1;
+    }
+    close(listener);
+
+    // only a socket is removed, a mistyped path must not delete a file
+    struct stat info;
+    if(lstat(socket_path.c_str(), &info) == 0)
+    {
+        if(!S_ISSOCK(info.st_mode))
+        {
+            std::cout << "ERROR serving, " << socket_path << " exists and is not a socket" << std::endl;
+            return 1;
+        }
+        unlink(socket_path.c_str());
+    }
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0)
+    {
+        std::cout << "ERROR serving, cannot listen on " << socket_path << std::endl;
+        if(listener >= 0)
+            close(listener);
+        return 1;
+    }
+
+    // connections get a thread each to wait on their socket, the assembling
+    // itself is done on the pool all of them share
+    ThreadPool pool(threads);
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t active = 0;
+    std::atomic<bool> stopping(false);
+
+    while(!stopping)
+    {
+        int client = accept(listener, nullptr, nullptr);
+        if(client < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break; // the listener was shut down by a stop request
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active++;
+        }
+        std::thread([&, client]
+        {
+            if(handle(client, pool) && !stopping.exchange(true))
+                shutdown(listener, SHUT_RDWR); // wakes accept
+            close(client);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            active--;
+            finished.notify_all();
+        }).detach();
+    }
+
+    // requests that are running still get their reply
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return active == 0; });
+    }
+
+    close(listener);
+    unlink(socket_path.c_str());
+    return stopping ? 0 : 1;
+}
+
+int send_request(const std::string& socket_path, const std::vector<std::string>& args, bool stop)
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(!socket_address(socket_path, address) || fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0)
+    {
+        std::cout << "ERROR connecting to server " << socket_path << std::endl;
+        if(fd >= 0)
+            close(fd);
+        return 1;
+    }
+
+    Connection connection(fd);
+    bool sent = connection.write("cwd", std::filesystem::current_path().string());
+    bool has_source = false;
+    for(const std::string& arg : args)
+    {
+        sent = sent && connection.write("arg", arg);
+        has_source = has_source || arg == "-";
+    }
+    // the server can't read this process's standard input, so it is sent along
+    if(has_source)
+    {
+        std::string source((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+        sent = sent && connection.write("source", source);
+    }
+    if(stop)
+        sent = sent && connection.write("stop", "");
+    sent = sent && connection.write("end", "");
+
+    std::string name, value;
+    while(sent && connection.read(name, value))
+    {
+        if(name == "out")
+            std::cout << value << std::flush;
+        else if(name == "err")
+            std::cerr << value << std::flush;
+        else if(name == "status")
+        {
+            close(fd);
+            return atoi(value.c_str());
+        }
+    }
+
+    close(fd);
+    std::cout << "ERROR connecting to server " << socket_path << ", no reply" << std::endl;
+    return 1;
+}
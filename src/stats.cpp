@@ -0,0 +1,96 @@
+#include <iomanip>
+
+#include "../inc/stats.h"
+
+void Stats::add(const Stats& other)
+{
+    read += other.read;
+    first_pass += other.first_pass;
+    second_pass += other.second_pass;
+    output += other.output;
+    peephole += other.peephole;
+
+    files += other.files;
+    cached += other.cached;
+    lines += other.lines;
+    symbols += other.symbols;
+    relocations += other.relocations;
+    bytes += other.bytes;
+
+    // sections with the same name add up, like the linker joins them
+    for(const auto& section : other.saved)
+    {
+        saved[section.first].instructions += section.second.instructions;
+        saved[section.first].bytes += section.second.bytes;
+    }
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+#ifdef ASSEMBLER_STATS
+static const char* COUNTER_NAMES[] = {"tokens", "operands", "symbol_lookups", "probes"};
+#endif
+
+void print_stats(std::ostream& out, const Stats& stats, bool json)
+{
+    if(json)
+    {
+        out << "{\"files\": " << stats.files << ", \"cached\": " << stats.cached << ", \"lines\": " << stats.lines << ", \"symbols\": " << stats.symbols
+            << ", \"relocations\": " << stats.relocations << ", \"bytes\": " << stats.bytes
+            << ", \"seconds\": {\"read\": " << stats.read << ", \"first_pass\": " << stats.first_pass
+            << ", \"second_pass\": " << stats.second_pass << ", \"output\": " << stats.output;
+        if(!stats.saved.empty())
+            out << ", \"peephole\": " << stats.peephole;
+        out << "}";
+        if(!stats.saved.empty())
+        {
+            out << ", \"peephole\": {";
+            for(auto section = stats.saved.begin(); section != stats.saved.end(); section++)
+            {
+                out << (section != stats.saved.begin() ? ", " : "") << "\"" << section->first << "\": {\"instructions\": "
+                    << section->second.instructions << ", \"bytes\": " << section->second.bytes << "}";
+            }
+            out << "}";
+        }
+#ifdef ASSEMBLER_STATS
+        out << ", \"counters\": {";
+        for(int i = 0; i < (int)Counter::COUNT; i++)
+            out << (i ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << stat_counters[i].load();
+        out << "}";
+#else
+        out << ", \"counters\": null";
+#endif
+        out << "}" << std::endl;
+        return;
+    }
+
+    out << "files " << stats.files << " (" << stats.cached << " cached), lines " << stats.lines << ", symbols " << stats.symbols
+        << ", relocations " << stats.relocations << ", bytes " << stats.bytes << "\n";
+
+    out << std::fixed << std::setprecision(3);
+    out << "  read         " << std::setw(10) << stats.read * 1000 << " ms\n";
+    out << "  first pass   " << std::setw(10) << stats.first_pass * 1000 << " ms\n";
+    out << "  second pass  " << std::setw(10) << stats.second_pass * 1000 << " ms\n";
+    out << "  output       " << std::setw(10) << stats.output * 1000 << " ms\n";
+    if(!stats.saved.empty())
+        out << "  peephole     " << std::setw(10) << stats.peephole * 1000 << " ms\n";
+    out << std::defaultfloat;
+
+    // what the peephole stage removed from every section
+    for(const auto& section : stats.saved)
+    {
+        out << "  saved in " << std::left << std::setw(12) << section.first << std::right
+            << section.second.instructions << " instructions, " << section.second.bytes << " bytes\n";
+    }
+
+#ifdef ASSEMBLER_STATS
+    for(int i = 0; i < (int)Counter::COUNT; i++)
+        out << "  " << std::left << std::setw(15) << COUNTER_NAMES[i] << std::right << stat_counters[i].load() << "\n";
+#else
+    out << "  counters are not built in, rebuild with make STATS=1\n";
+#endif
+    out << std::flush;
+}
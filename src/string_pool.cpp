@@ -0,0 +1,84 @@
+#include <algorithm>
+
+#include "../inc/string_pool.h"
+
+StringPool::StringPool() : names(arena), slots(64, Slot{0, -1})
+{
+}
+
+int StringPool::intern(std::string_view text)
+{
+    // keep the table at most half full so probe sequences stay short
+    if((size() + 1) * 2 > slots.size())
+        grow();
+
+    uint32_t h = hash(text);
+    size_t pos = probe(text, h);
+    if(slots[pos].id != -1)
+        return slots[pos].id;
+
+    int id = size();
+    slots[pos] = Slot{h, id};
+    names.push_back(arena.copy(text));
+    return id;
+}
+
+void StringPool::clear()
+{
+    names.clear();
+    arena.clear();
+    std::fill(slots.begin(), slots.end(), Slot{0, -1});
+}
+
+int StringPool::find(std::string_view text) const
+{
+    size_t pos = probe(text, hash(text));
+    return slots[pos].id;
+}
+
+// FNV-1a
+uint32_t StringPool::hash(std::string_view text)
+{
+    uint32_t h = 2166136261u;
+    for(char c : text)
+    {
+        h ^= (unsigned char)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+size_t StringPool::probe(std::string_view text, uint32_t h) const
+{
+    size_t mask = slots.size() - 1;
+    size_t pos = h & mask;
+
+    // linear probing, there is always an empty slot to stop at
+    STAT_ADD(PROBES, 1);
+    while(slots[pos].id != -1)
+    {
+        if(slots[pos].hash == h && names[slots[pos].id] == text)
+            break;
+        pos = (pos + 1) & mask;
+        STAT_ADD(PROBES, 1);
+    }
+    return pos;
+}
+
+void StringPool::grow()
+{
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.size() * 2, Slot{0, -1});
+
+    size_t mask = slots.size() - 1;
+    for(const Slot& slot : old)
+    {
+        if(slot.id == -1)
+            continue;
+
+        size_t pos = slot.hash & mask;
+        while(slots[pos].id != -1)
+            pos = (pos + 1) & mask;
+        slots[pos] = slot;
+    }
+}
@@ -0,0 +1,47 @@
+#include "../inc/symbol_table.h"
+
+SymbolTable::SymbolTable(StringPool& _names) : pool(_names), labels(arena), sections(arena), offsets(arena), scopes(arena)
+{
+    section_id("UND");
+    section_id("ABS");
+}
+
+void SymbolTable::clear()
+{
+    labels.clear();
+    sections.clear();
+    offsets.clear();
+    scopes.clear();
+    arena.clear();
+    symbol_of.clear();
+
+    section_id("UND");
+    section_id("ABS");
+}
+
+int SymbolTable::insert(std::string_view label, int section, int32_t offset, char scope)
+{
+    int id = pool.intern(label);
+    if((size_t)id >= symbol_of.size())
+        symbol_of.resize(pool.size(), -1);
+    if(symbol_of[id] != -1)
+        return -1;
+
+    int index = size();
+    symbol_of[id] = index;
+
+    labels.push_back(id);
+    sections.push_back(section);
+    offsets.push_back(offset);
+    scopes.push_back(scope);
+    return index;
+}
+
+int SymbolTable::find(std::string_view label) const
+{
+    STAT_ADD(SYMBOL_LOOKUPS, 1);
+    int id = pool.find(label);
+    if(id == -1 || (size_t)id >= symbol_of.size())
+        return -1;
+    return symbol_of[id];
+}
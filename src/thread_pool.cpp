@@ -0,0 +1,155 @@
+#include "../inc/thread_pool.h"
+
+// set for the worker threads, so nested calls use their own queue
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local uint current_queue = 0;
+
+ThreadPool::ThreadPool(uint threads) : queued(0), stopping(false)
+{
+    if(threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if(threads == 0)
+        threads = 1;
+
+    // one queue per worker and one for the threads outside the pool
+    for(uint i = 0; i < threads; i++)
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+
+    for(uint i = 0; i + 1 < threads; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for(std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& task)
+{
+    if(count == 0)
+        return;
+
+    Batch batch;
+    batch.task = &task;
+    batch.pending = count;
+    batch.error_index = 0;
+
+    uint id = own_queue();
+    {
+        // the owner takes tasks from the back, so the first one goes last
+        std::lock_guard<std::mutex> lock(queues.at(id)->mutex);
+        for(size_t i = count; i > 0; i--)
+            queues.at(id)->tasks.push_back(Task{&batch, i - 1});
+        queued += count;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    wake.notify_all();
+
+    // the caller works too, on this batch or on anything else that is queued
+    while(batch.pending > 0)
+    {
+        if(run_one(id))
+            continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return batch.pending == 0 || queued > 0; });
+    }
+
+    if(batch.error)
+        std::rethrow_exception(batch.error);
+}
+
+void ThreadPool::worker_loop(uint id)
+{
+    current_pool = this;
+    current_queue = id;
+
+    while(true)
+    {
+        if(run_one(id))
+            continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if(stopping && queued == 0)
+            return;
+    }
+}
+
+uint ThreadPool::own_queue() const
+{
+    return current_pool == this ? current_queue : queues.size() - 1;
+}
+
+bool ThreadPool::run_one(uint id)
+{
+    Task task;
+    bool found = false;
+
+    // newest task of the own queue, it is the most likely to be in the cache
+    {
+        Queue& own = *queues.at(id);
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            queued--;
+            found = true;
+        }
+    }
+
+    // steal the oldest task of another queue
+    for(uint i = 1; i < queues.size() && !found; i++)
+    {
+        Queue& other = *queues.at((id + i) % queues.size());
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if(!other.tasks.empty())
+        {
+            task = other.tasks.front();
+            other.tasks.pop_front();
+            queued--;
+            found = true;
+        }
+    }
+
+    if(found)
+        run(task);
+    return found;
+}
+
+void ThreadPool::run(const Task& task)
+{
+    Batch& batch = *task.batch;
+    try
+    {
+        (*batch.task)(task.index);
+    }
+    catch(...)
+    {
+        std::lock_guard<std::mutex> lock(batch.error_mutex);
+        if(!batch.error || task.index < batch.error_index)
+        {
+            batch.error = std::current_exception();
+            batch.error_index = task.index;
+        }
+    }
+
+    // the batch may be gone once pending is 0, only the pool is used after that
+    if(--batch.pending == 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        wake.notify_all();
+    }
+}
@@ -0,0 +1,159 @@
+#!/bin/sh
+# checks run by make test, from the repository; prints what failed and exits 1 if anything did
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+failed=0
+
+fail()
+{
+    echo "FAIL $1"
+    failed=1
+}
+
+# --one-pass writes the same objects as the two passes
+for f in tests/*.s; do
+    name=$(basename "$f" .s)
+    ./assembler -o "$out/$name.o" "$f" || { fail "$f does not assemble"; continue; }
+    ./assembler --one-pass -o "$out/$name.one.o" "$f" || { fail "$f does not assemble with --one-pass"; continue; }
+    cmp -s "$out/$name.o" "$out/$name.one.o" || fail "$f, --one-pass output differs"
+done
+
+# -j splits both passes into chunks, the output does not depend on it; the tests are
+# smaller than a chunk, so a long source with reopened sections and forward references is made
+# too; its push and pop pairs give --peephole something to remove
+awk 'BEGIN {
+    print ".global l0"
+    print ".extern ext"
+    for(i = 0; i < 60000; i++)
+    {
+        if(i % 7000 == 0)
+            print ".section s" (i / 7000) % 3
+        if(i % 5 == 0)
+            printf "l%d: ", i
+        k = i % 9
+        if(k == 0) print "ldr r1, $l" (i + 500 - (i + 500) % 5)
+        else if(k == 1) print "jmp %l" (i - i % 5)
+        else if(k == 2) print ".word l" (i - i % 5) ", ext"
+        else if(k == 3) print ".skip " i % 4
+        else if(k == 4) print "str r2, [r3 + l" (i - i % 5) "]"
+        else if(k == 5) print "push r0"
+        else if(k == 6) print "pop r" i % 6
+        else print "add r" i % 6 ", r" (i + 1) % 6
+    }
+    for(i = 60000; i < 60500; i += 5)
+        print "l" i ": halt"
+    print ".end"
+}' > "$out/long.s"
+
+for f in tests/*.s "$out/long.s"; do
+    name=$(basename "$f" .s)
+    ./assembler -j 1 -o "$out/$name.j1.o" "$f" || { fail "$f does not assemble with -j 1"; continue; }
+    ./assembler -j 8 -o "$out/$name.j8.o" "$f" || { fail "$f does not assemble with -j 8"; continue; }
+    cmp -s "$out/$name.j1.o" "$out/$name.j8.o" || fail "$f, -j 8 output differs from -j 1"
+done
+./assembler --one-pass -o "$out/long.one.o" "$out/long.s" && cmp -s "$out/long.j1.o" "$out/long.one.o" || fail "long source, --one-pass output differs"
+
+# --peephole applies each of its patterns once to tests/test_peephole.s, the program
+# ends in the same registers, apart from the pc, as without it
+./assembler --peephole --stats -o "$out/peephole.o" tests/test_peephole.s > "$out/peephole.log" 2>&1 &&
+    grep -q "saved in text *7 instructions, 27 bytes" "$out/peephole.log" || fail "--peephole does not remove what tests/test_peephole.s has"
+for engine in plain peephole; do
+    flag=$([ $engine = peephole ] && echo --peephole)
+    ./assembler $flag -o "$out/$engine.o" tests/test_peephole.s &&
+        ./linker -place=ivt@0 -o "$out/$engine.hex" "$out/$engine.o" > /dev/null &&
+        ./emulator --no-devices "$out/$engine.hex" | grep "^r" | sed 's/r7=.*//' > "$out/$engine.regs" || fail "tests/test_peephole.s $flag does not run"
+done
+cmp -s "$out/plain.regs" "$out/peephole.regs" || fail "tests/test_peephole.s ends in other registers with --peephole"
+./assembler --peephole -j 1 -o "$out/long.peephole.j1.o" "$out/long.s" &&
+    ./assembler --peephole --stats -j 8 -o "$out/long.peephole.j8.o" "$out/long.s" > "$out/peephole.log" 2>&1 &&
+    cmp -s "$out/long.peephole.j1.o" "$out/long.peephole.j8.o" || fail "long source, --peephole -j 8 output differs from -j 1"
+grep -q "saved in s0 *[1-9]" "$out/peephole.log" || fail "long source, --peephole removes nothing"
+
+# the linker and the disassembler read long names back
+./assembler -o "$out/long_names.o" tests/test_long_names.s &&
+    ./linker -o "$out/long_names.hex" "$out/long_names.o" > /dev/null || fail "long names do not link"
+./assembler -d -o "$out/long_names.dis.s" "$out/long_names.o" &&
+    ./assembler -o "$out/long_names.dis.o" "$out/long_names.dis.s" &&
+    cmp -s "$out/long_names.o" "$out/long_names.dis.o" || fail "long names do not disassemble to the same object"
+
+# int r1 jumps to the vector r1 holds, on the interpreter and with --jit
+./assembler -o "$out/int.o" tests/test_int.s && ./linker -place=ivt@0 -o "$out/int.hex" "$out/int.o" > /dev/null || fail "tests/test_int.s does not link"
+for engine in "" --jit; do
+    ./emulator --no-devices $engine "$out/int.hex" | grep -q "r2=0x0007" || fail "int $engine does not use the vector in its register"
+done
+
+# a full disk is an error, not a short object
+if [ -w /dev/full ]; then
+    ./assembler -o /dev/full tests/test_one.s > /dev/null 2>&1 && fail "writing to a full disk is not an error"
+    ./assembler -d -o /dev/full "$out/test_one.o" > /dev/null 2>&1 && fail "disassembling to a full disk is not an error"
+fi
+
+# the object cache: a second run is copied from it, a changed include or --peephole is not
+mkdir -p "$out/cached"
+printf '.include "constants.s"\n.section text\nldr r1, $k\npush r1\npop r1\nhalt\n.end\n' > "$out/cached/main.s"
+printf '.equ k, 5\n' > "$out/cached/constants.s"
+cached()
+{
+    ./assembler --cache-dir "$out/cache" --stats $2 -o "$out/cached/$1.o" "$out/cached/main.s" 2>&1 | head -n 1 | grep -o "[0-9] cached"
+}
+[ "$(cached first)" = "0 cached" ] || fail "the cache is not empty at first"
+[ "$(cached second)" = "1 cached" ] || fail "an unchanged source is not copied from the cache"
+cmp -s "$out/cached/first.o" "$out/cached/second.o" || fail "the cached object differs"
+printf '.equ k, 6\n' > "$out/cached/constants.s"
+[ "$(cached changed)" = "0 cached" ] || fail "a changed include is copied from the cache"
+cmp -s "$out/cached/first.o" "$out/cached/changed.o" && fail "a changed include gives the same object"
+[ "$(cached peephole --peephole)" = "0 cached" ] || fail "--peephole is copied from the entry without it"
+[ "$(cached peephole2 --peephole)" = "1 cached" ] || fail "--peephole has no entry of its own"
+cmp -s "$out/cached/peephole.o" "$out/cached/peephole2.o" || fail "the cached --peephole object differs"
+cmp -s "$out/cached/changed.o" "$out/cached/peephole.o" && fail "--peephole gives the same object"
+
+# a server writes the same objects as the direct runs, for several clients at once
+./assembler -j 4 --serve "$out/s.sock" > "$out/serve.log" 2>&1 &
+server=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S "$out/s.sock" ] && break
+    sleep 0.2
+done
+mkdir -p "$out/served"
+for f in tests/*.s; do
+    name=$(basename "$f" .s)
+    ./assembler --server "$out/s.sock" -o "$out/served/$name.o" "$f" > /dev/null &&
+        cmp -s "$out/$name.o" "$out/served/$name.o" || fail "$f, the server output differs"
+done
+./assembler --server "$out/s.sock" -o "$out/served/stdin.o" - < tests/test_one.s > /dev/null &&
+    cmp -s "$out/test_one.o" "$out/served/stdin.o" || fail "the server output of - differs"
+clients=""
+for i in 1 2 3 4; do
+    mkdir -p "$out/served/$i"
+    ./assembler --server "$out/s.sock" -o "$out/served/$i/" tests/*.s > "$out/served/$i.log" 2>&1 &
+    clients="$clients $!"
+done
+for pid in $clients; do
+    wait $pid || fail "a client run at the same time as others failed"
+done
+for i in 1 2 3 4; do
+    for f in tests/*.s; do
+        name=$(basename "$f" .s)
+        cmp -s "$out/$name.o" "$out/served/$i/$name.o" || fail "$f, the server output differs with clients at the same time"
+    done
+done
+./assembler --server "$out/s.sock" --stop > /dev/null || fail "the server does not stop"
+wait $server
+[ -e "$out/s.sock" ] && fail "the server leaves its socket behind"
+
+# sources that are errors, they have to stop with one instead of writing anything
+error()
+{
+    printf "$2" > "$out/error.s"
+    for engine in "" --one-pass --peephole; do
+        ./assembler $engine -o "$out/error.o" "$out/error.s" > "$out/error.log" 2>&1 && fail "$1 $engine is not an error"
+    done
+}
+error "a .skip larger than the address space" ".section data\n.skip 0x10001\n.end\n"
+error "a literal of more than 32 bits" ".section data\n.skip 99999999999\n.end\n"
+error "a literal that wraps to 0" ".section data\n.skip 0x100000000\n.end\n"
+error "a file that includes itself by another path" ".include \"./error.s\"\n.end\n"
+grep -q "includes itself" "$out/error.log" || fail "an include cycle is not reported as one"
+
+[ $failed = 0 ] && echo "all tests passed"
+exit $failed
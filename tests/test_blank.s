@@ -0,0 +1,6 @@
+# code before the first .section goes into the section BLANK
+halt
+x: .word 5
+.section text
+ldr r1, $x
+.end
@@ -0,0 +1,15 @@
+# int takes the vector from its register, linked with -place=ivt@0 it ends with r2 set by isr_five
+.section ivt
+.word start
+.skip 8
+.word isr_five
+.skip 4
+.section text
+start:
+ldr r1, $5
+int r1
+halt
+isr_five:
+ldr r2, $7
+iret
+.end
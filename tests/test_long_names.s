@@ -0,0 +1,8 @@
+# names of 15 characters and more fill the symbol table columns
+.global a_very_long_label_name
+.section interrupt_vectors
+a_very_long_label_name: .word a_very_long_label_name
+.section text
+ldr r1, $a_very_long_label_name
+halt
+.end
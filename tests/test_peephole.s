@@ -0,0 +1,26 @@
+# one of each pattern --peephole removes or rewrites, the labels and the .word
+# after them move back; run on the emulator it ends the same either way
+.section ivt
+.word start
+.skip 14
+.section text
+start:
+ldr r1, $3
+push r1
+pop r1 # both removed
+push r1
+pop r2 # ldr r2, r1
+ldr r3, r3 # removed
+ldr r4, $1
+ldr r4, $1 # removed
+ldr r5, $9 # removed
+ldr r5, $2
+jmp next # removed
+next:
+ldr r0, value
+ldr r3, table
+ldr r3, [r3]
+halt
+value: .word 0x1234
+table: .word value
+.end